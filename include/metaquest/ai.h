@@ -14,6 +14,12 @@
 
 #include <metaquest/game.h>
 #include <random>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <algorithm>
 
 namespace metaquest {
 namespace ai {
@@ -36,7 +42,7 @@ public:
   std::vector<metaquest::character<T> *>
   query(G &game, const metaquest::character<T> &source,
         const std::vector<metaquest::character<T> *> &candidates,
-        std::size_t indent = 4) {
+        std::size_t indent = 4, const std::string &action = "") {
     std::vector<metaquest::character<T> *> targets;
     targets.push_back(candidates[(rng() % candidates.size())]);
     return targets;
@@ -46,6 +52,236 @@ protected:
   inter &interact;
   std::mt19937 rng;
 };
+
+/**\brief Least-recently-used map
+ *
+ * A bounded, thread-safe key/value store that evicts whichever entry was
+ * looked up or stored the longest time ago once it grows past its capacity.
+ *
+ * \tparam K Key type; needs to be hashable.
+ * \tparam V Value type.
+ */
+template <typename K, typename V> class lru {
+public:
+  lru(std::size_t pCapacity = 4096)
+      : capacity(pCapacity), hits(0), misses(0) {}
+
+  /**\brief Look up an entry
+   *
+   * \param[in]  key   The key to look for.
+   * \param[out] value Set to the stored value, if there is one.
+   *
+   * \returns 'true' if the key was found, in which case it also becomes the
+   *          most recently used entry.
+   */
+  bool get(const K &key, V &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto it = index.find(key);
+    if (it == index.end()) {
+      misses++;
+      return false;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    value = it->second->second;
+    hits++;
+    return true;
+  }
+
+  void put(const K &key, const V &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto it = index.find(key);
+    if (it != index.end()) {
+      it->second->second = value;
+      entries.splice(entries.begin(), entries, it->second);
+      return;
+    }
+
+    entries.emplace_front(key, value);
+    index[key] = entries.begin();
+
+    evict();
+  }
+
+  void resize(std::size_t pCapacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    capacity = pCapacity;
+    evict();
+  }
+
+  std::size_t size(void) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return entries.size();
+  }
+
+  std::atomic<std::size_t> hits;
+  std::atomic<std::size_t> misses;
+
+protected:
+  void evict(void) {
+    while (entries.size() > capacity) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+  }
+
+  std::mutex mutex;
+  std::size_t capacity;
+  std::list<std::pair<K, V>> entries;
+  std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> index;
+};
+
+/**\brief Decision cache in front of another AI
+ *
+ * Many decisions an AI makes come up over and over again: the same kind of
+ * character, with roughly the same amount of HP and MP left, looking at the
+ * same list of options. This class abstracts a situation into a coarse key
+ * and remembers what the wrapped AI decided in it, so that expensive AIs only
+ * need to be consulted when something new comes up.
+ *
+ * The decisions are kept in LRU maps that are shared by all instances of the
+ * same cache type, so they carry over between battles and threads.
+ *
+ * To use this as the AI of an interaction, bind the wrapped AI with an alias,
+ * e.g.:
+ *
+ * \code
+ * template <typename inter> using cachedRandom = ai::cache<inter, ai::random>;
+ * \endcode
+ *
+ * The 'simulate' programme does this when run with --ai=cached, and prints
+ * how often the cache could answer.
+ *
+ * \tparam inter The interaction type.
+ * \tparam AI    The AI to ask when the cache can't answer.
+ */
+template <typename inter, template <typename> class AI = random>
+class cache : public AI<inter> {
+public:
+  using parent = AI<inter>;
+
+  cache(inter &pInteract)
+      : parent(pInteract), exploration(0.05), bands(4),
+        explorer(std::random_device()()) {}
+
+  /**\brief Exploration rate
+   *
+   * The probability with which a cached decision is ignored and the wrapped
+   * AI is asked anyway; the new answer then replaces the cached one.
+   */
+  double exploration;
+
+  /**\brief Resource bands
+   *
+   * The number of bands that HP and MP are quantised into when building a
+   * situation key. Empty resources always get a band of their own.
+   */
+  std::size_t bands;
+
+  template <typename T, typename G>
+  std::string query(const G &game, const metaquest::character<T> &source,
+                    const std::vector<std::string> &list,
+                    std::size_t indent = 4, std::string carry = "") {
+    std::ostringstream key("");
+    key << situation(source) << "|" << carry;
+    for (const auto &l : list) {
+      key << "|" << l;
+    }
+
+    std::string r;
+    if (!explore() && actions().get(key.str(), r)) {
+      return r;
+    }
+
+    r = parent::query(game, source, list, indent, carry);
+    actions().put(key.str(), r);
+    return r;
+  }
+
+  template <typename T, typename G>
+  std::vector<metaquest::character<T> *>
+  query(G &game, const metaquest::character<T> &source,
+        const std::vector<metaquest::character<T> *> &candidates,
+        std::size_t indent = 4, const std::string &action = "") {
+    std::ostringstream key("");
+    key << action << "|" << source.archetype() << "|"
+        << situation(source);
+    for (const auto &c : candidates) {
+      key << "|" << band((*c)["HP/Current"], (*c)["HP/Total"])
+          << (game.partyOf(*c) == game.partyOf(source) ? "a" : "e");
+    }
+
+    std::vector<std::size_t> r;
+    if (!explore() && targets().get(key.str(), r)) {
+      std::vector<metaquest::character<T> *> res;
+      for (const auto &i : r) {
+        res.push_back(candidates[i]);
+      }
+      return res;
+    }
+
+    const auto res = parent::query(game, source, candidates, indent, action);
+    for (const auto &t : res) {
+      const auto it = std::find(candidates.begin(), candidates.end(), t);
+      if (it == candidates.end()) {
+        // the wrapped AI picked someone outside the candidate list, so
+        // there's no way to express this decision as a reusable index.
+        return res;
+      }
+      r.push_back(it - candidates.begin());
+    }
+
+    targets().put(key.str(), r);
+    return res;
+  }
+
+  /**\brief Cached action decisions
+   *
+   * \returns The LRU map with the action choices of this cache type.
+   */
+  static lru<std::string, std::string> &actions(void) {
+    static lru<std::string, std::string> decisions;
+    return decisions;
+  }
+
+  /**\brief Cached target decisions
+   *
+   * \returns The LRU map with the target choices of this cache type, stored
+   *          as indices into the candidate list.
+   */
+  static lru<std::string, std::vector<std::size_t>> &targets(void) {
+    static lru<std::string, std::vector<std::size_t>> decisions;
+    return decisions;
+  }
+
+protected:
+  std::mt19937 explorer;
+
+  bool explore(void) {
+    return std::uniform_real_distribution<double>(0, 1)(explorer) <
+           exploration;
+  }
+
+  template <typename T> std::size_t band(const T &current, const T &total) {
+    if (current <= 0 || total <= 0) {
+      return 0;
+    }
+
+    return std::min<std::size_t>(bands, 1 + (current * bands - 1) / total);
+  }
+
+  template <typename T>
+  std::string situation(const metaquest::character<T> &source) {
+    std::ostringstream os("");
+    os << band(source["HP/Current"], source["HP/Total"]) << "/"
+       << band(source["MP/Current"], source["MP/Total"]);
+    return os.str();
+  }
+};
 }
 }
 
@@ -0,0 +1,109 @@
+/**\file
+ * \brief Automatic interaction
+ *
+ * Contains an interaction that leaves every decision to an AI and doesn't
+ * display anything, for running battles unattended.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_AUTOMATIC_H)
+#define METAQUEST_AUTOMATIC_H
+
+#include <metaquest/character.h>
+#include <metaquest/ai.h>
+#include <metaquest/dashboard-probe.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace metaquest {
+namespace interact {
+/**\brief Automatic interaction
+ *
+ * Hands all queries to the AI, including those for the player party, and
+ * otherwise does nothing. The AI is never offered the option to quit.
+ *
+ * If a probe is set, every action is counted in it, and the battle is
+ * copied into it whenever it asks for a sample.
+ *
+ * \tparam AI The AI that makes all decisions.
+ */
+template <template <typename> class AI = ai::random> class automatic {
+public:
+  automatic(void) : ai(*this), probe(nullptr) {}
+
+  AI<automatic> ai;
+
+  /**\brief Where to report to, if anywhere */
+  dashboard::probe *probe;
+
+  void clear(void) {}
+
+  template <typename G> void drawUI(G &) {}
+
+  void log(std::string) {}
+
+  bool display(const std::string &, const std::map<std::string, std::string> &,
+               std::size_t = 8) {
+    return true;
+  }
+
+  template <typename G>
+  bool action(const G &, const std::string &,
+              const metaquest::character<typename G::num> &,
+              const std::vector<metaquest::character<typename G::num> *> &) {
+    return true;
+  }
+
+  template <typename T, typename G>
+  std::string query(const G &game, const metaquest::character<T> &source,
+                    const std::vector<std::string> &pList,
+                    std::size_t indent = 4, std::string carry = "") {
+    std::vector<std::string> list;
+    for (const auto &l : pList) {
+      if (l != "Quit/Yes") {
+        list.push_back(l);
+      }
+    }
+
+    return ai.query(game, source, list, indent, carry);
+  }
+
+  template <typename T, typename G>
+  std::optional<std::vector<metaquest::character<T> *>>
+  query(G &game, const metaquest::character<T> &source,
+        std::vector<metaquest::character<T> *> &candidates,
+        std::size_t indent = 4, const std::string &action = "") {
+    return ai.query(game, source, candidates, indent, action);
+  }
+
+  template <typename G>
+  void
+  record(const G &game, const std::string &description,
+         const metaquest::character<typename G::num> &source,
+         const std::vector<metaquest::character<typename G::num> *> &targets,
+         const std::vector<typename G::num> &amounts, std::size_t turn) {
+    if (probe == nullptr) {
+      return;
+    }
+
+    probe->add(probe->actions);
+
+    if (probe->wanted.load(std::memory_order_relaxed)) {
+      probe->sample(game, source.name.display() + ": " + description, turn);
+    }
+  }
+};
+}
+}
+
+#endif
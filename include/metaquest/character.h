@@ -102,6 +102,20 @@ public:
 
   std::vector<std::string> visibleActions(void) const { return actions; }
 
+  /**\brief Character archetype
+   *
+   * Characters are told apart by the actions they can take.
+   *
+   * \returns The character's actions, each followed by a comma.
+   */
+  std::string archetype(void) const {
+    std::string rv;
+    for (const auto &a : actions) {
+      rv += a + ",";
+    }
+    return rv;
+  }
+
   virtual std::set<std::string> attributes(void) const {
     auto rv = parent::attributes();
     for (const auto &item : equipment) {
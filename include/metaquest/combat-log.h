@@ -0,0 +1,576 @@
+/**\file
+ * \brief Columnar combat log
+ *
+ * Contains a column store for combat actions, which keeps every action as a
+ * row of small integers so that statistics over large numbers of battles are
+ * cheap to compute.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_COMBAT_LOG_H)
+#define METAQUEST_COMBAT_LOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace metaquest {
+namespace columnar {
+static inline std::uint64_t zigzag(std::int64_t v) {
+  return (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63);
+}
+
+static inline std::int64_t unzigzag(std::uint64_t v) {
+  return std::int64_t(v >> 1) ^ -std::int64_t(v & 1);
+}
+
+static inline void putVarint(std::string &out, std::uint64_t v) {
+  while (v >= 0x80) {
+    out += char(v | 0x80);
+    v >>= 7;
+  }
+  out += char(v);
+}
+
+static inline bool getVarint(const std::string &in, std::size_t &pos,
+                             std::uint64_t &v) {
+  v = 0;
+  for (unsigned shift = 0; (pos < in.size()) && (shift < 64); shift += 7) {
+    const unsigned char b = in[pos++];
+    v |= std::uint64_t(b & 0x7f) << shift;
+    if (b < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**\brief Combat log segment
+ *
+ * A batch of rows, one column per field. Each row has a variable number of
+ * targets; row i's targets are those from targetOffset[i] up to
+ * targetOffset[i+1], with the change in HP each of them saw in 'delta'.
+ * Actors, archetypes, actions and targets are dictionary IDs. Actors and
+ * targets are identified by their party and position in it, e.g. "1/2", so
+ * characters that happen to share a name aren't mixed up.
+ *
+ * Damage and healing are totalled in separate columns, so an action that
+ * hurts one target and heals another doesn't cancel out.
+ */
+class segment {
+public:
+  segment(void) { clear(); }
+
+  std::vector<std::uint32_t> turn;
+  std::vector<std::uint32_t> actor;
+  std::vector<std::uint32_t> party;
+
+  /**\brief The actor's archetype, i.e. the actions it can take */
+  std::vector<std::uint32_t> archetype;
+
+  std::vector<std::uint32_t> action;
+  std::vector<std::uint32_t> targetOffset;
+  std::vector<std::uint32_t> target;
+  std::vector<std::int64_t> delta;
+
+  /**\brief HP lost per row, over all targets */
+  std::vector<std::int64_t> damage;
+
+  /**\brief HP gained per row, over all targets */
+  std::vector<std::int64_t> healing;
+
+  std::size_t size(void) const { return turn.size(); }
+
+  void clear(void) {
+    turn.clear();
+    actor.clear();
+    party.clear();
+    archetype.clear();
+    action.clear();
+    targetOffset.assign(1, 0);
+    target.clear();
+    delta.clear();
+    damage.clear();
+    healing.clear();
+  }
+};
+
+/**\brief Column store for combat actions
+ *
+ * Rows are added to an in-memory tail, which is sealed into a compressed
+ * segment once it reaches 'segmentSize' rows. Sealed segments are appended
+ * to a file if one was opened, or kept in memory otherwise.
+ *
+ * Segments start with "MQCL" and their length, followed by the dictionary
+ * entries that were added since the previous segment, followed by the
+ * columns. Each column is stored as its element count, its length in bytes
+ * and then its values as zigzag varints; turns and target offsets are delta
+ * encoded first. Queries only decode the columns they need.
+ */
+class store {
+public:
+  /**\brief Fields that queries can group by */
+  enum field { turn, actor, party, archetype, action };
+
+  /**\brief Values that queries can add up */
+  enum measure { rows, damage, healing };
+
+  store(std::size_t pSegmentSize = 4096)
+      : segmentSize(pSegmentSize), total(0), written(0) {}
+
+  ~store(void) { seal(); }
+
+  /**\brief Use a log file
+   *
+   * Reads the dictionary from the segments already in the file, and appends
+   * segments to it from then on. Rows that were only kept in memory so far
+   * are added to the file as well, after the rows already in it.
+   *
+   * \param[in] pFile The log file to use.
+   *
+   * \returns 'true' if the file could be opened.
+   */
+  bool open(const std::string &pFile) {
+    seal();
+
+    std::vector<segment> kept(sealed.size());
+    for (std::size_t i = 0; i < sealed.size(); i++) {
+      unpack(sealed[i], kept[i]);
+    }
+    const std::vector<std::string> previous = names;
+
+    file = pFile;
+    total = 0;
+    names.clear();
+    ids.clear();
+    sealed.clear();
+
+    std::ifstream in(file, std::ios::binary);
+    std::string body;
+    while (read(in, body)) {
+      std::size_t pos = 0;
+      std::uint64_t n = 0;
+      getVarint(body, pos, n);
+      total += n;
+      dictionary(body, pos, true);
+    }
+    written = names.size();
+
+    output.close();
+    output.clear();
+    output.open(file, std::ios::binary | std::ios::app);
+
+    std::vector<std::pair<std::string, std::int64_t>> targets;
+    for (const auto &s : kept) {
+      for (std::size_t i = 0; i < s.size(); i++) {
+        targets.clear();
+        for (std::size_t t = s.targetOffset[i]; t < s.targetOffset[i + 1];
+             t++) {
+          targets.push_back({previous[s.target[t]], s.delta[t]});
+        }
+        push(s.turn[i], previous[s.actor[i]], s.party[i],
+             previous[s.archetype[i]], previous[s.action[i]], targets);
+      }
+    }
+    seal();
+
+    return bool(output);
+  }
+
+  /**\brief Add a row
+   *
+   * \param[in] pTurn      The turn the action happened in.
+   * \param[in] pActor     Who performed the action.
+   * \param[in] pParty     The party of the actor.
+   * \param[in] pArchetype The archetype of the actor.
+   * \param[in] pAction    The action that was performed.
+   * \param[in] pTargets   Who the action was performed on, with the change
+   *                       in HP each of them saw.
+   */
+  void
+  push(std::uint32_t pTurn, const std::string &pActor, std::uint32_t pParty,
+       const std::string &pArchetype, const std::string &pAction,
+       const std::vector<std::pair<std::string, std::int64_t>> &pTargets) {
+    std::int64_t lost = 0, gained = 0;
+
+    tail.turn.push_back(pTurn);
+    tail.actor.push_back(id(pActor));
+    tail.party.push_back(pParty);
+    tail.archetype.push_back(id(pArchetype));
+    tail.action.push_back(id(pAction));
+
+    for (const auto &t : pTargets) {
+      tail.target.push_back(id(t.first));
+      tail.delta.push_back(t.second);
+      (t.second < 0 ? lost : gained) += t.second;
+    }
+
+    tail.targetOffset.push_back(tail.target.size());
+    tail.damage.push_back(-lost);
+    tail.healing.push_back(gained);
+
+    total++;
+
+    if (tail.size() >= segmentSize) {
+      seal();
+    }
+  }
+
+  /**\brief Seal the tail
+   *
+   * Compresses all rows that aren't in a segment yet into a new segment.
+   */
+  void seal(void) {
+    if (tail.size() == 0) {
+      return;
+    }
+
+    std::string body;
+    putVarint(body, tail.size());
+    putVarint(body, names.size() - written);
+    for (; written < names.size(); written++) {
+      putVarint(body, names[written].size());
+      body += names[written];
+    }
+
+    encode(body, tail.turn, true);
+    encode(body, tail.actor, false);
+    encode(body, tail.party, false);
+    encode(body, tail.archetype, false);
+    encode(body, tail.action, false);
+    encode(body, tail.targetOffset, true);
+    encode(body, tail.target, false);
+    encode(body, tail.delta, false);
+    encode(body, tail.damage, false);
+    encode(body, tail.healing, false);
+
+    std::string header = "MQCL";
+    putVarint(header, body.size());
+
+    if (output.is_open()) {
+      output << header << body;
+      output.flush();
+    } else {
+      sealed.push_back(body);
+    }
+
+    tail.clear();
+  }
+
+  /**\brief Number of rows */
+  std::size_t size(void) const { return total; }
+
+  /**\brief Total HP lost, grouped
+   *
+   * \param[in] by The field to group rows by.
+   *
+   * \returns The HP that targets lost over all rows, for each value of the
+   *          given field.
+   */
+  std::map<std::string, std::int64_t> damageDone(enum field by) const {
+    return aggregate(by, damage);
+  }
+
+  /**\brief Total HP gained, grouped
+   *
+   * \param[in] by The field to group rows by.
+   *
+   * \returns The HP that targets gained over all rows, for each value of the
+   *          given field.
+   */
+  std::map<std::string, std::int64_t> healingDone(enum field by) const {
+    return aggregate(by, healing);
+  }
+
+  /**\brief Number of rows, grouped
+   *
+   * \param[in] by The field to group rows by.
+   *
+   * \returns The number of rows for each value of the given field.
+   */
+  std::map<std::string, std::int64_t> count(enum field by) const {
+    return aggregate(by, rows);
+  }
+
+  /**\brief Rows per segment */
+  std::size_t segmentSize;
+
+protected:
+  segment tail;
+  std::size_t total;
+
+  /**\brief Dictionary entries, by ID */
+  std::vector<std::string> names;
+  std::unordered_map<std::string, std::uint32_t> ids;
+
+  /**\brief Number of dictionary entries already in a segment */
+  std::size_t written;
+
+  /**\brief Sealed segments, if there is no log file */
+  std::vector<std::string> sealed;
+
+  std::string file;
+  std::ofstream output;
+
+  std::uint32_t id(const std::string &name) {
+    const auto it = ids.find(name);
+    if (it != ids.end()) {
+      return it->second;
+    }
+
+    const std::uint32_t i = names.size();
+    names.push_back(name);
+    ids[name] = i;
+    return i;
+  }
+
+  template <typename V>
+  static void encode(std::string &out, const std::vector<V> &column,
+                     bool delta) {
+    std::string values;
+    std::int64_t previous = 0;
+
+    for (const auto &v : column) {
+      const std::int64_t x = std::int64_t(v);
+      putVarint(values, zigzag(delta ? x - previous : x));
+      previous = x;
+    }
+
+    putVarint(out, column.size());
+    putVarint(out, values.size());
+    out += values;
+  }
+
+  /**\brief Decode or skip a column
+   *
+   * \param[in]  in     The segment to decode from.
+   * \param[in]  pos    Where the column starts; set to where it ends.
+   * \param[out] column Where to decode the column to, or 'nullptr' to skip
+   *                    over it.
+   * \param[in]  delta  Whether the column is delta encoded.
+   */
+  template <typename V>
+  static void decode(const std::string &in, std::size_t &pos,
+                     std::vector<V> *column, bool delta) {
+    std::uint64_t n = 0, bytes = 0, v = 0;
+    getVarint(in, pos, n);
+    getVarint(in, pos, bytes);
+
+    if (column == nullptr) {
+      pos += bytes;
+      return;
+    }
+
+    column->resize(n);
+    std::int64_t previous = 0;
+    for (auto &c : *column) {
+      getVarint(in, pos, v);
+      previous = delta ? previous + unzigzag(v) : unzigzag(v);
+      c = V(previous);
+    }
+  }
+
+  void dictionary(const std::string &body, std::size_t &pos, bool add) {
+    std::uint64_t n = 0, len = 0;
+    getVarint(body, pos, n);
+
+    for (std::uint64_t i = 0; i < n; i++) {
+      getVarint(body, pos, len);
+      if (add) {
+        id(body.substr(pos, len));
+      }
+      pos += len;
+    }
+  }
+
+  static bool read(std::istream &in, std::string &body) {
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != "MQCL") {
+      return false;
+    }
+
+    std::uint64_t len = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      const int b = in.get();
+      if (b < 0) {
+        return false;
+      }
+      len |= std::uint64_t(b & 0x7f) << shift;
+      if (b < 0x80) {
+        break;
+      }
+    }
+
+    body.resize(len);
+    return bool(in.read(&body[0], len));
+  }
+
+  /**\brief Skip a segment's dictionary entries
+   *
+   * \param[in] body The encoded segment.
+   *
+   * \returns Where the segment's columns start.
+   */
+  static std::size_t columns(const std::string &body) {
+    std::size_t pos = 0;
+    std::uint64_t n = 0, len = 0;
+    getVarint(body, pos, n);
+    getVarint(body, pos, n);
+    for (std::uint64_t i = 0; i < n; i++) {
+      getVarint(body, pos, len);
+      pos += len;
+    }
+    return pos;
+  }
+
+  /**\brief Decode the columns a query needs
+   *
+   * \param[in]  body The encoded segment.
+   * \param[out] s    Where to decode to.
+   * \param[in]  by   The field that is grouped by.
+   * \param[in]  m    The value that is added up.
+   */
+  static void unpack(const std::string &body, segment &s, enum field by,
+                     enum measure m) {
+    std::size_t pos = columns(body);
+
+    decode(body, pos, by == turn ? &s.turn : nullptr, true);
+    decode(body, pos, by == actor ? &s.actor : nullptr, false);
+    decode(body, pos, by == party ? &s.party : nullptr, false);
+    decode(body, pos, by == archetype ? &s.archetype : nullptr, false);
+    decode(body, pos, by == action ? &s.action : nullptr, false);
+    decode(body, pos, (std::vector<std::uint32_t> *)nullptr, true);
+    decode(body, pos, (std::vector<std::uint32_t> *)nullptr, false);
+    decode(body, pos, (std::vector<std::int64_t> *)nullptr, false);
+    decode(body, pos, m == damage ? &s.damage : nullptr, false);
+    decode(body, pos, m == healing ? &s.healing : nullptr, false);
+  }
+
+  /**\brief Decode all columns
+   *
+   * \param[in]  body The encoded segment.
+   * \param[out] s    Where to decode to.
+   */
+  static void unpack(const std::string &body, segment &s) {
+    std::size_t pos = columns(body);
+
+    decode(body, pos, &s.turn, true);
+    decode(body, pos, &s.actor, false);
+    decode(body, pos, &s.party, false);
+    decode(body, pos, &s.archetype, false);
+    decode(body, pos, &s.action, false);
+    decode(body, pos, &s.targetOffset, true);
+    decode(body, pos, &s.target, false);
+    decode(body, pos, &s.delta, false);
+    decode(body, pos, &s.damage, false);
+    decode(body, pos, &s.healing, false);
+  }
+
+  static const std::vector<std::uint32_t> &column(const segment &s,
+                                                  enum field by) {
+    switch (by) {
+    case turn:
+      return s.turn;
+    case actor:
+      return s.actor;
+    case party:
+      return s.party;
+    case archetype:
+      return s.archetype;
+    case action:
+    default:
+      return s.action;
+    }
+  }
+
+  /**\brief Group and add up a segment
+   *
+   * The inner loops only touch two flat arrays, so the compiler is free to
+   * vectorise them.
+   */
+  static void accumulate(const segment &s, enum field by, enum measure m,
+                         std::vector<std::int64_t> &totals) {
+    const auto &keys = column(s, by);
+    if (keys.empty()) {
+      return;
+    }
+
+    const std::size_t top = *std::max_element(keys.begin(), keys.end());
+    if (top >= totals.size()) {
+      totals.resize(top + 1, 0);
+    }
+
+    const std::uint32_t *k = keys.data();
+    std::int64_t *t = totals.data();
+    const std::size_t n = keys.size();
+
+    if (m != rows) {
+      const std::int64_t *a = (m == damage ? s.damage : s.healing).data();
+      for (std::size_t i = 0; i < n; i++) {
+        t[k[i]] += a[i];
+      }
+    } else {
+      for (std::size_t i = 0; i < n; i++) {
+        t[k[i]]++;
+      }
+    }
+  }
+
+  std::map<std::string, std::int64_t> aggregate(enum field by,
+                                                enum measure m) const {
+    std::vector<std::int64_t> totals;
+    std::vector<bool> seen;
+    segment s;
+
+    const auto visit = [&](const segment &seg) {
+      accumulate(seg, by, m, totals);
+      seen.resize(totals.size(), false);
+      for (const auto &k : column(seg, by)) {
+        seen[k] = true;
+      }
+    };
+
+    if (!file.empty()) {
+      std::ifstream in(file, std::ios::binary);
+      std::string body;
+      while (read(in, body)) {
+        unpack(body, s, by, m);
+        visit(s);
+      }
+    }
+
+    for (const auto &body : sealed) {
+      unpack(body, s, by, m);
+      visit(s);
+    }
+
+    visit(tail);
+
+    std::map<std::string, std::int64_t> rv;
+    for (std::size_t k = 0; k < totals.size(); k++) {
+      if (!seen[k]) {
+        continue;
+      }
+      const bool named = (by == actor) || (by == archetype) || (by == action);
+      rv[named ? names[k] : std::to_string(k)] = totals[k];
+    }
+
+    return rv;
+  }
+};
+}
+}
+
+#endif
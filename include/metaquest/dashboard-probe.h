@@ -0,0 +1,127 @@
+/**\file
+ * \brief Simulation probes
+ *
+ * Contains the counters and samples that simulation workers publish for the
+ * dashboard to read.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_DASHBOARD_PROBE_H)
+#define METAQUEST_DASHBOARD_PROBE_H
+
+#include <metaquest/queue.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace metaquest {
+namespace dashboard {
+/**\brief Battle sample
+ *
+ * A copy of the state of a running battle, taken by a worker when the
+ * dashboard asked for one.
+ */
+class snapshot {
+public:
+  class row {
+  public:
+    std::size_t party;
+    std::string name;
+    long hp;
+    long hpTotal;
+    long mp;
+    long mpTotal;
+  };
+
+  /**\brief The battle number, counting from one, within its worker */
+  std::size_t battle;
+
+  std::size_t turn;
+
+  /**\brief The action that was just carried out */
+  std::string action;
+
+  std::vector<row> rows;
+};
+
+/**\brief Worker probe
+ *
+ * Counters that a single simulation worker updates and the dashboard reads.
+ * Each counter only has one writer, so updates are plain relaxed stores
+ * rather than read-modify-write operations, and the probe is aligned to a
+ * cache line so workers don't contend with each other.
+ *
+ * Samples are only taken when the dashboard asks for one, by setting
+ * 'wanted', so that the workers don't spend any time on them otherwise.
+ */
+class alignas(64) probe {
+public:
+  probe(void)
+      : battles(0), victories(0), defeats(0), draws(0), actions(0),
+        wanted(false), samples(4) {}
+
+  std::atomic<std::size_t> battles;
+  std::atomic<std::size_t> victories;
+  std::atomic<std::size_t> defeats;
+
+  /**\brief Battles that were stopped for running too long */
+  std::atomic<std::size_t> draws;
+
+  std::atomic<std::size_t> actions;
+
+  /**\brief Set by the dashboard to ask for a sample */
+  std::atomic<bool> wanted;
+
+  /**\brief Samples, from the worker to the dashboard */
+  queue<snapshot> samples;
+
+  /**\brief Increment a counter
+   *
+   * Only to be used by the worker that owns the probe.
+   *
+   * \param[out] counter The counter to increment.
+   * \param[in]  n       What to add to it.
+   */
+  void add(std::atomic<std::size_t> &counter, std::size_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  /**\brief Take a sample
+   *
+   * \param[in] game   The battle to copy.
+   * \param[in] action What just happened in it.
+   * \param[in] turn   The current turn.
+   */
+  template <typename G>
+  void sample(const G &game, const std::string &action, std::size_t turn) {
+    snapshot s;
+
+    s.battle = battles.load(std::memory_order_relaxed);
+    s.turn = turn;
+    s.action = action;
+
+    for (std::size_t pa = 0; pa < game.parties.size(); pa++) {
+      for (const auto &c : game.parties[pa]) {
+        s.rows.push_back({pa, c.name.full(), long(c["HP/Current"]),
+                          long(c["HP/Total"]), long(c["MP/Current"]),
+                          long(c["MP/Total"])});
+      }
+    }
+
+    (void)samples.push(std::move(s));
+    wanted.store(false, std::memory_order_relaxed);
+  }
+};
+}
+}
+
+#endif
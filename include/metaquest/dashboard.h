@@ -0,0 +1,252 @@
+/**\file
+ * \brief Simulation dashboard
+ *
+ * Contains a worker loop for running unattended battles, and a terminal view
+ * that shows how a set of such workers is doing.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_DASHBOARD_H)
+#define METAQUEST_DASHBOARD_H
+
+#include <metaquest/dashboard-probe.h>
+#include <metaquest/terminal.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace metaquest {
+namespace dashboard {
+/**\brief Run battles
+ *
+ * Starts one battle after the other until told to stop, and counts them in
+ * the given probe.
+ *
+ * \tparam I The interaction to use; needs a 'probe' member, as
+ *           interact::automatic has.
+ * \tparam G The game logic to use; needs a fight() action that starts a new
+ *           battle, as rules::simple::game has.
+ *
+ * \param[out] p          Where to count battles and actions.
+ * \param[in]  running    Checked between actions; the worker returns once
+ *                        this is 'false'.
+ * \param[in]  maxActions Battles that take more actions than this are called
+ *                        a draw.
+ */
+template <typename I, typename G>
+void simulate(probe &p, const std::atomic<bool> &running,
+              std::size_t maxActions = 1000) {
+  while (running.load(std::memory_order_relaxed)) {
+    I interact;
+    interact.probe = &p;
+    G game(interact);
+
+    bool retry = false;
+    game.fight(retry, game.parties[0][0]);
+    p.add(p.battles);
+
+    std::size_t actions = 0;
+    for (bool done = false; !done && running.load(std::memory_order_relaxed);) {
+      switch (game.state()) {
+      case G::combat:
+        if (++actions > maxActions) {
+          p.add(p.draws);
+          done = true;
+        } else {
+          game.doCombat();
+        }
+        break;
+      case G::victory:
+        p.add(p.victories);
+        done = true;
+        break;
+      case G::defeat:
+        p.add(p.defeats);
+        done = true;
+        break;
+      default:
+        done = true;
+        break;
+      }
+    }
+  }
+}
+
+/**\brief Dashboard
+ *
+ * Shows totals, rates and the outcome of all battles run by a set of
+ * workers, along with one battle in progress. The workers are never waited
+ * on: counters are read with relaxed loads, and a sample of one worker's
+ * battle is asked for every few updates, round robin.
+ *
+ * \tparam term The terminal to draw on.
+ */
+template <typename term = interact::terminal::buffered<>> class view {
+public:
+  view(std::vector<probe> &pProbes, std::size_t pSampleEvery = 4)
+      : probes(pProbes), sampleEvery(pSampleEvery), updates(0),
+        started(std::chrono::steady_clock::now()), previous(started) {}
+
+  /**\brief The terminal interaction used for drawing */
+  interact::terminal::base<term> display;
+
+  /**\brief Counter totals over all probes */
+  class totals {
+  public:
+    std::size_t battles = 0;
+    std::size_t victories = 0;
+    std::size_t defeats = 0;
+    std::size_t draws = 0;
+    std::size_t actions = 0;
+  };
+
+  /**\brief Add up all probes
+   *
+   * \returns The current totals; may be slightly out of date.
+   */
+  totals sum(void) const {
+    totals t;
+
+    for (const auto &p : probes) {
+      t.battles += p.battles.load(std::memory_order_relaxed);
+      t.victories += p.victories.load(std::memory_order_relaxed);
+      t.defeats += p.defeats.load(std::memory_order_relaxed);
+      t.draws += p.draws.load(std::memory_order_relaxed);
+      t.actions += p.actions.load(std::memory_order_relaxed);
+    }
+
+    return t;
+  }
+
+  /**\brief Draw the dashboard
+   *
+   * Meant to be called a few times per second.
+   */
+  void update(void) {
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed =
+        std::chrono::duration<double>(now - started).count();
+    const double dt = std::chrono::duration<double>(now - previous).count();
+    const totals t = sum();
+
+    if ((updates++ % sampleEvery == 0) && !probes.empty()) {
+      probes[(updates / sampleEvery) % probes.size()].wanted.store(
+          true, std::memory_order_relaxed);
+    }
+
+    for (std::size_t i = 0; i < probes.size(); i++) {
+      snapshot s;
+      while (probes[i].samples.pop(s)) {
+        current = s;
+        worker = i;
+      }
+    }
+
+    const std::size_t finished = t.victories + t.defeats + t.draws;
+    std::vector<std::string> lines;
+    std::ostringstream os("");
+
+    os << "metaquest simulation: " << probes.size() << " workers, "
+       << std::fixed << std::setprecision(0) << elapsed << "s";
+    lines.push_back(os.str());
+
+    os.str("");
+    os << "battles " << t.battles << " (" << std::setprecision(1)
+       << (dt > 0 ? (t.battles - last.battles) / dt : 0) << "/s) | actions "
+       << t.actions << " (" << std::setprecision(0)
+       << (dt > 0 ? (t.actions - last.actions) / dt : 0) << "/s)";
+    lines.push_back(os.str());
+
+    os.str("");
+    os << "victories " << percent(t.victories, finished) << " | defeats "
+       << percent(t.defeats, finished) << " | draws "
+       << percent(t.draws, finished);
+    lines.push_back(os.str());
+
+    os.str("");
+    if (!current.rows.empty()) {
+      os << "worker " << worker << ", battle " << current.battle << ", turn "
+         << current.turn << ": " << current.action;
+    }
+    lines.push_back(os.str());
+
+    last = t;
+    previous = now;
+
+    const snapshot s = current;
+    display.render([this, lines, t, finished, s]() {
+      auto &out = display.out;
+      const std::size_t height = display.screen[1];
+
+      out.foreground = 7;
+      out.background = 0;
+
+      for (std::size_t l = 0; l < lines.size(); l++) {
+        out.to(0, l).clear(-1, 1).to(1, l).write(lines[l], lines[l].size());
+      }
+
+      out.to(0, 2).x(-50).bar2c(t.victories, finished, t.defeats, finished,
+                                 50, 2, 1);
+
+      std::size_t l = lines.size() + 1;
+      for (const auto &r : s.rows) {
+        if (l >= height) {
+          break;
+        }
+        out.to(0, l)
+            .clear(-1, 1)
+            .to(1, l)
+            .write(std::to_string(r.party), 2)
+            .to(4, l)
+            .write(r.name, 28)
+            .x(-60)
+            .write(std::to_string(r.hp), 4, 1)
+            .x(-55)
+            .write(std::to_string(r.mp), 4, 4)
+            .x(-50)
+            .bar2c(r.hp, r.hpTotal, r.mp, r.mpTotal, 50, 1, 4);
+        l++;
+      }
+
+      if (l < height) {
+        out.to(0, l).clear(-1, height - l);
+      }
+
+      display.damage(0, height);
+    });
+  }
+
+protected:
+  std::vector<probe> &probes;
+  const std::size_t sampleEvery;
+  std::size_t updates;
+
+  const std::chrono::steady_clock::time_point started;
+  std::chrono::steady_clock::time_point previous;
+  totals last;
+
+  snapshot current;
+  std::size_t worker = 0;
+
+  static std::string percent(std::size_t n, std::size_t total) {
+    std::ostringstream os("");
+    os << std::fixed << std::setprecision(1)
+       << (total > 0 ? 100. * n / total : 0.) << "%";
+    return os.str();
+  }
+};
+}
+}
+
+#endif
@@ -37,6 +37,13 @@ public:
 
   std::vector<party> parties;
 
+  /**\brief Action revision
+   *
+   * Renewed whenever an action is bound, so anything derived from the
+   * actions' costs, like resource labels, can be kept until this changes.
+   */
+  std::size_t actionRevision = metaquest::revision();
+
   enum state { menu, combat, victory, defeat, exit };
 
   virtual enum state state(void) const {
@@ -79,7 +86,7 @@ public:
                  std::back_inserter(filteredCandidates),
                  [](character *cha) -> bool { return cha->able(); });
 
-    std::random_shuffle(filteredCandidates.begin(), filteredCandidates.end());
+    std::shuffle(filteredCandidates.begin(), filteredCandidates.end(), rng);
 
     return filteredCandidates;
   }
@@ -419,13 +426,14 @@ public:
   }
 
   std::vector<character *> resolve(const character &c, const std::string &s) {
-    return resolve(c, scope(s), filter(s));
+    return resolve(c, scope(s), filter(s), true, s);
   }
 
   std::vector<character *> resolve(const character &c,
                                    const enum action::scope scope,
                                    const enum action::filter filter,
-                                   bool query = true) {
+                                   bool query = true,
+                                   const std::string &action = "") {
     size_t p = partyOf(c);
     size_t m = positionOf(c);
 
@@ -513,7 +521,7 @@ public:
       return filteredCandidates;
     case action::ally:
     case action::enemy: {
-      auto q = interact.query(*this, c, filteredCandidates, 8);
+      auto q = interact.query(*this, c, filteredCandidates, 8, action);
       if (!q) {
         return std::vector<character *>();
       } else {
@@ -612,7 +620,21 @@ public:
 
     cost.apply(c);
 
-    return action(source, target);
+    std::vector<num> before;
+    for (const auto &t : pTarget) {
+      before.push_back((*t)["HP/Current"]);
+    }
+
+    const std::string rv = action(source, target);
+
+    std::vector<num> amounts;
+    for (std::size_t i = 0; i < pTarget.size(); i++) {
+      amounts.push_back((*pTarget[i])["HP/Current"] - before[i]);
+    }
+
+    interact.record(*this, action.name.display(), c, pTarget, amounts, turn);
+
+    return rv;
   }
 
   virtual efgy::json::json json(const character &c) const {
@@ -629,9 +651,9 @@ public:
     const auto it = characterAction.find(act);
     if (it == characterAction.end()) {
       return "";
-    } else {
-      return it->second.cost.label(c);
     }
+
+    return it->second.cost.label(c);
   }
 
   const enum action::scope scope(const std::string &act) const {
@@ -676,6 +698,7 @@ protected:
        const resource::total<num> pCost = {}) {
     action act(isVisible, pApply, pScope, pFilter, pCost);
     act.name = metaquest::name::simple<>(name);
+    actionRevision = metaquest::revision();
     characterAction[name] = act;
     return characterAction[name];
   }
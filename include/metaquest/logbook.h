@@ -0,0 +1,254 @@
+/**\file
+ * \brief Combat logbook
+ *
+ * Contains a bounded log of recent entries that streams older entries to an
+ * append-only file, so the log doesn't grow in memory or in save files.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_LOGBOOK_H)
+#define METAQUEST_LOGBOOK_H
+
+#include <ef.gy/json.h>
+#include <ef.gy/stream-json.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace metaquest {
+/**\brief Bounded, streaming logbook
+ *
+ * Keeps the most recent entries in memory. Once there are more than that,
+ * the oldest entries are appended to a log file as JSON, one entry per line,
+ * or dropped if there is no log file. Entries are numbered in the order they
+ * were recorded, starting with the first line of the log file, and can be
+ * paged through with page(). Dropped entries keep their numbers, but can't be
+ * read any more, so without a log file only the entries in memory are
+ * available.
+ *
+ * To be able to seek in the log file, the offset of every 'stride'th line is
+ * kept in memory.
+ */
+class logbook {
+public:
+  /**\brief Construct with capacity
+   *
+   * \param[in] pCapacity The number of entries to keep in memory.
+   * \param[in] pStride   Keep the file offset of every this many entries.
+   */
+  logbook(std::size_t pCapacity = 256, std::size_t pStride = 64)
+      : capacity(pCapacity), stride(pStride), archived(0), dropped(0),
+        end(0) {}
+
+  /**\brief Use a log file
+   *
+   * Opens the given file for appending; entries already in it are indexed
+   * and stay available through page(). Entries are numbered from the start
+   * of the file from then on.
+   *
+   * \param[in] pFile The log file to use.
+   *
+   * \returns 'true' if the file could be opened.
+   */
+  bool open(const std::string &pFile) {
+    file = pFile;
+    archived = dropped = end = 0;
+    index.clear();
+
+    std::ifstream in(file, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (archived % stride == 0) {
+        index.push_back(end);
+      }
+      archived++;
+      end += line.size() + 1;
+    }
+
+    output.close();
+    output.clear();
+    output.open(file, std::ios::binary | std::ios::app);
+
+    return bool(output);
+  }
+
+  /**\brief Add an entry
+   *
+   * \param[in] entry The entry to add.
+   */
+  void push(const efgy::json::json &entry) {
+    recent.push_back(entry);
+
+    while (recent.size() > capacity) {
+      retire(recent.front());
+      recent.pop_front();
+    }
+  }
+
+  /**\brief Number of entries
+   *
+   * \returns The number of entries that were recorded, i.e. the ones in the
+   *          log file, the ones that were dropped and the ones still in
+   *          memory.
+   */
+  std::size_t size(void) const { return archived + recent.size(); }
+
+  /**\brief First available entry
+   *
+   * \returns The number of the first entry that page() can return; entries
+   *          before it were dropped because there was no log file.
+   */
+  std::size_t first(void) const { return dropped; }
+
+  /**\brief Read entries
+   *
+   * \param[in] pFirst The number of the first entry to return.
+   * \param[in] count  The maximum number of entries to return.
+   *
+   * \returns The requested entries; fewer than 'count' if the log ends
+   *          before that, or if some of them were dropped. Dropped entries
+   *          are skipped, so the result starts at first() if 'pFirst' is
+   *          before that.
+   */
+  std::vector<efgy::json::json> page(std::size_t pFirst, std::size_t count) {
+    std::vector<efgy::json::json> rv;
+    std::size_t n = pFirst;
+
+    if (n < dropped) {
+      count -= std::min(count, dropped - n);
+      n = dropped;
+    }
+
+    if (n < archived) {
+      output.flush();
+
+      const std::size_t l = n - dropped, lines = archived - dropped;
+      std::ifstream in(file, std::ios::binary);
+      in.seekg(index[l / stride]);
+
+      std::string line;
+      for (std::size_t i = l / stride * stride;
+           (i < lines) && (rv.size() < count) && std::getline(in, line);
+           i++) {
+        if (i >= l) {
+          efgy::json::json entry;
+          line >> entry;
+          rv.push_back(entry);
+        }
+      }
+
+      n = archived;
+    }
+
+    for (; (n - archived < recent.size()) && (rv.size() < count); n++) {
+      rv.push_back(recent[n - archived]);
+    }
+
+    return rv;
+  }
+
+  /**\brief Load entries
+   *
+   * Takes a JSON array of entries, as written by json(). Older saves may
+   * contain more entries than fit in memory; the excess is aged out as usual.
+   *
+   * \param[in] json The entries to load.
+   *
+   * \returns 'true' if the entries were loaded.
+   */
+  bool load(efgy::json::json json) {
+    if (!json.isArray()) {
+      return false;
+    }
+
+    recent.clear();
+    for (const auto &entry : json.asArray()) {
+      push(entry);
+    }
+
+    return true;
+  }
+
+  /**\brief Recent entries
+   *
+   * \returns A JSON array with the entries that are still in memory.
+   */
+  efgy::json::json json(void) const {
+    efgy::json::json rv;
+
+    rv.toArray();
+    for (const auto &entry : recent) {
+      rv.push(entry);
+    }
+
+    return rv;
+  }
+
+  /**\brief Number of entries to keep in memory */
+  std::size_t capacity;
+
+  /**\brief Distance between indexed lines in the log file */
+  const std::size_t stride;
+
+protected:
+  std::deque<efgy::json::json> recent;
+
+  std::string file;
+  std::ofstream output;
+
+  /**\brief Number of entries that are no longer in memory
+   *
+   * Counts the entries that were dropped as well as those in the log file,
+   * so entries keep their numbers either way.
+   */
+  std::size_t archived;
+
+  /**\brief Number of entries that were dropped for lack of a log file */
+  std::size_t dropped;
+
+  /**\brief Size of the log file, in bytes */
+  std::size_t end;
+
+  /**\brief Offsets of every 'stride'th line in the log file */
+  std::vector<std::size_t> index;
+
+  void retire(const efgy::json::json &entry) {
+    if (!output.is_open()) {
+      archived++;
+      dropped++;
+      return;
+    }
+
+    std::ostringstream oss("");
+    oss << efgy::json::tag() << entry;
+
+    std::string line = oss.str();
+    for (auto &c : line) {
+      if (c == '\n') {
+        c = ' ';
+      }
+    }
+
+    if ((archived - dropped) % stride == 0) {
+      index.push_back(end);
+    }
+    archived++;
+    end += line.size() + 1;
+
+    output << line << "\n";
+  }
+};
+}
+
+#endif
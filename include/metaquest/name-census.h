@@ -0,0 +1,260 @@
+/**\file
+ * \brief Census name sampling
+ *
+ * Contains a name generator that picks real names from the census data,
+ * weighted by how common they are, instead of making up new ones.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_NAME_CENSUS_H)
+#define METAQUEST_NAME_CENSUS_H
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace metaquest {
+namespace name {
+/**\brief Census names
+ *
+ * The makefile builds an alias table for each of the census data sets and
+ * writes it to include/data/\*.alias.h; the classes in here draw names from
+ * those tables.
+ */
+namespace census {
+/**\brief Alias table
+ *
+ * A read-only view of the table in one of the generated data headers. Names
+ * are sorted by length. Each entry has the name, its weight, the probability
+ * of keeping the entry when it's drawn, scaled to 2^32, and the entry to use
+ * instead when it isn't kept.
+ *
+ * Drawing names with a length limit uses a separate alias table over the
+ * names that are short enough. These are built the first time a limit is
+ * used and never change after that, so they can be read from any thread.
+ */
+class table {
+public:
+  /**\brief Entry: name, weight, probability of keeping it, alias */
+  using entry = std::tuple<const char *, long, unsigned long, unsigned long>;
+
+  /**\brief Construct with a generated table
+   *
+   * \param[in] pEntries The alias table for a data set.
+   */
+  template <std::size_t N>
+  table(const std::array<entry, N> &pEntries)
+      : entries(pEntries.data()), size(N),
+        longest(N > 0 ? std::strlen(std::get<0>(pEntries[N - 1])) : 0) {
+    for (auto &b : built) {
+      b = false;
+    }
+  }
+
+  table(const table &) = delete;
+  table &operator=(const table &) = delete;
+
+  /**\brief Longest length limit with a separate alias table */
+  static constexpr unsigned int limit = 64;
+
+  /**\brief Number of names no longer than a limit
+   *
+   * \param[in] length The maximum length of the names to count.
+   *
+   * \returns How many of the first entries are at most 'length' long.
+   */
+  std::size_t shorter(unsigned int length) const {
+    std::size_t lo = 0, hi = size;
+    while (lo < hi) {
+      const std::size_t mid = lo + (hi - lo) / 2;
+      if (std::strlen(std::get<0>(entries[mid])) <= length) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  /**\brief Alias table for a length limit
+   *
+   * \param[in] length The maximum length of the names to draw; less than
+   *                   'limit'.
+   *
+   * \returns For every name that is at most 'length' long, the probability
+   *          of keeping it and its alias, like in the generated table.
+   */
+  const std::vector<std::pair<unsigned long, unsigned long>> &
+  limited(unsigned int length) const {
+    if (!built[length].load(std::memory_order_acquire)) {
+      build(length);
+    }
+    return rows[length];
+  }
+
+  const entry *entries;
+
+  /**\brief Number of names */
+  std::size_t size;
+
+  /**\brief Length of the longest name */
+  std::size_t longest;
+
+protected:
+  mutable std::array<std::vector<std::pair<unsigned long, unsigned long>>,
+                     limit>
+      rows;
+  mutable std::array<std::atomic<bool>, limit> built;
+  mutable std::mutex mutex;
+
+  void build(unsigned int length) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (built[length].load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    const std::size_t n = shorter(length);
+    auto &row = rows[length];
+    row.resize(n);
+
+    double total = 0;
+    for (std::size_t i = 0; i < n; i++) {
+      total += std::get<1>(entries[i]);
+    }
+
+    std::vector<double> p(n);
+    std::vector<std::size_t> small, large;
+    for (std::size_t i = 0; i < n; i++) {
+      p[i] = std::get<1>(entries[i]) * n / total;
+      (p[i] < 1 ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+      const std::size_t s = small.back(), g = large.back();
+      small.pop_back();
+      large.pop_back();
+      row[s] = {(unsigned long)(p[s] * 4294967296.), g};
+      p[g] += p[s] - 1;
+      (p[g] < 1 ? small : large).push_back(g);
+    }
+    for (const auto i : large) {
+      row[i] = {4294967296ul, i};
+    }
+    for (const auto i : small) {
+      row[i] = {4294967296ul, i};
+    }
+
+    built[length].store(true, std::memory_order_release);
+  }
+};
+
+/**\brief Census name sampler
+ *
+ * Draws names from a census alias table, so each name comes up as often as it
+ * does in the census data. Every draw takes one uniform index and one uniform
+ * number, no matter how many names there are.
+ *
+ * Like markov::chain, the sampler only holds references to a PRNG and a
+ * table, and can be used wherever a name generator is expected.
+ *
+ * \tparam T The type used for single characters in names.
+ * \tparam R The PRNG to draw from.
+ */
+template <typename T = char, typename R = std::mt19937> class sampler {
+public:
+  /**\brief Table type */
+  typedef census::table table;
+
+  /**\brief PRNG type */
+  typedef R random;
+
+  /**\brief Construct with PRNG and table
+   *
+   * \param[in] pRNG   The PRNG to draw from.
+   * \param[in] pTable The alias table to draw from.
+   */
+  sampler(random &pRNG, const table &pTable) : rng(pRNG), data(pTable) {}
+
+  /**\brief Draw a name
+   *
+   * \param[out] out Set to a name from the table.
+   *
+   * \returns The sampler itself.
+   */
+  sampler &operator>>(std::basic_string<T> &out) {
+    out.clear();
+    append(out);
+    return *this;
+  }
+
+  /**\brief Draw a name in place
+   *
+   * Appends a name from the table to the given string.
+   *
+   * \param[out] out The string to append the name to.
+   */
+  void append(std::basic_string<T> &out) {
+    const std::size_t i = index(data.size);
+    const auto &e = data.entries[i];
+    put(out, draw() < std::get<2>(e) ? i : std::get<3>(e));
+  }
+
+  /**\brief Draw a name of limited length in place
+   *
+   * Appends a name with at most 'length' characters to the given string,
+   * drawn from the names that are short enough with their relative weights.
+   *
+   * \param[out] out    The string to append the name to.
+   * \param[in]  length The maximum length of the name. Nothing is appended
+   *                    if the table has no names that short.
+   */
+  void append(std::basic_string<T> &out, unsigned int length) {
+    if ((length >= data.longest) || (length >= table::limit)) {
+      append(out);
+      return;
+    }
+
+    const auto &row = data.limited(length);
+    if (row.empty()) {
+      return;
+    }
+
+    const std::size_t i = index(row.size());
+    put(out, draw() < row[i].first ? i : row[i].second);
+  }
+
+protected:
+  random &rng;
+  const table &data;
+
+  std::size_t index(std::size_t n) {
+    return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+  }
+
+  unsigned long draw(void) {
+    return std::uniform_int_distribution<unsigned long>(0, 4294967295ul)(rng);
+  }
+
+  void put(std::basic_string<T> &out, std::size_t i) {
+    for (const char *c = std::get<0>(data.entries[i]); *c != 0; c++) {
+      out.push_back(T(*c));
+    }
+  }
+};
+}
+}
+}
+
+#endif
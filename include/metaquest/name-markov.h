@@ -0,0 +1,278 @@
+/**\file
+ * \brief Pretrained Markov chains for names
+ *
+ * Contains a Markov chain name generator that samples from transition tables
+ * which were trained at build time, so nothing needs to be trained when a
+ * programme starts.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_NAME_MARKOV_H)
+#define METAQUEST_NAME_MARKOV_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace metaquest {
+namespace name {
+/**\brief Pretrained Markov chains
+ *
+ * The makefile trains a chain on each of the census data sets and writes the
+ * result to include/data/\*.markov.h; the classes in here sample names from
+ * those tables.
+ */
+namespace markov {
+/**\brief Transition table
+ *
+ * A read-only view of the tables in one of the generated data headers. Each
+ * state has a range of transitions and the sum of their weights; each
+ * transition has the symbol it emits, its weight and the state it leads to.
+ * The symbol 0 ends a name, and every name starts in state 0.
+ *
+ * For walks with a length limit, the table also provides the probability that
+ * an unconstrained walk from a given state ends within a number of symbols.
+ * These are computed the first time a limit is used, one row per length, and
+ * never change after that, so they can be read from any thread.
+ */
+class table {
+public:
+  /**\brief State: first transition, one past the last, total weight */
+  using state = std::tuple<unsigned long, unsigned long, unsigned long>;
+
+  /**\brief Transition: symbol, weight, next state */
+  using transition = std::tuple<char, unsigned long, unsigned long>;
+
+  /**\brief Construct with generated tables
+   *
+   * \param[in] pStates      The states of a trained chain.
+   * \param[in] pTransitions The transitions of the same chain.
+   */
+  template <std::size_t S, std::size_t N>
+  table(const std::array<state, S> &pStates,
+        const std::array<transition, N> &pTransitions)
+      : states(pStates.data()), transitions(pTransitions.data()), size(S),
+        ready(0) {}
+
+  table(const table &) = delete;
+  table &operator=(const table &) = delete;
+
+  /**\brief Longest length limit that ending() can be asked about */
+  static constexpr unsigned int limit = 64;
+
+  /**\brief Probability of ending within a length
+   *
+   * \param[in] s      The state to start in.
+   * \param[in] length The most symbols to emit before the end; less than
+   *                   'limit'.
+   *
+   * \returns The probability that a walk starting in state 's' ends after
+   *          emitting no more than 'length' symbols.
+   */
+  double ending(unsigned long s, unsigned int length) const {
+    if (length >= ready.load(std::memory_order_acquire)) {
+      extend(length);
+    }
+    return rows[length][s];
+  }
+
+  const state *states;
+  const transition *transitions;
+
+  /**\brief Number of states */
+  std::size_t size;
+
+protected:
+  mutable std::array<std::vector<double>, limit> rows;
+  mutable std::atomic<unsigned int> ready;
+  mutable std::mutex mutex;
+
+  void extend(unsigned int length) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (unsigned int l = ready.load(std::memory_order_relaxed); l <= length;
+         l++) {
+      auto &row = rows[l];
+      row.resize(size);
+
+      for (std::size_t s = 0; s < size; s++) {
+        double p = 0;
+        for (unsigned long i = std::get<0>(states[s]);
+             i < std::get<1>(states[s]); i++) {
+          const auto &t = transitions[i];
+          if (std::get<0>(t) == 0) {
+            p += std::get<1>(t);
+          } else if (l > 0) {
+            p += std::get<1>(t) * rows[l - 1][std::get<2>(t)];
+          }
+        }
+        row[s] = p / std::get<2>(states[s]);
+      }
+
+      ready.store(l + 1, std::memory_order_release);
+    }
+  }
+};
+
+/**\brief Markov chain name generator
+ *
+ * Generates names by walking a pretrained transition table. The generator
+ * itself only holds references to a PRNG and a table, so it is cheap to
+ * construct, and several generators can share the same table.
+ *
+ * \tparam T The type used for single characters in names.
+ * \tparam R The PRNG to draw from.
+ */
+template <typename T = char, typename R = std::mt19937> class chain {
+public:
+  /**\brief Table type */
+  typedef markov::table table;
+
+  /**\brief PRNG type */
+  typedef R random;
+
+  /**\brief Construct with PRNG and table
+   *
+   * \param[in] pRNG   The PRNG to draw from.
+   * \param[in] pTable The trained transitions to walk.
+   */
+  chain(random &pRNG, const table &pTable) : rng(pRNG), data(pTable) {}
+
+  /**\brief Generate a name
+   *
+   * \param[out] out Set to a newly generated name.
+   *
+   * \returns The generator itself.
+   */
+  chain &operator>>(std::basic_string<T> &out) {
+    out.clear();
+    append(out);
+    return *this;
+  }
+
+  /**\brief Generate a name in place
+   *
+   * Appends a newly generated name to the given string.
+   *
+   * \param[out] out The string to append the name to.
+   */
+  void append(std::basic_string<T> &out) {
+    unsigned long s = 0;
+
+    for (;;) {
+      const auto &t = data.transitions[pick(data.states[s])];
+      if (std::get<0>(t) == 0) {
+        break;
+      }
+      out.push_back(T(std::get<0>(t)));
+      s = std::get<2>(t);
+    }
+  }
+
+  /**\brief Generate a name of limited length in place
+   *
+   * Appends a newly generated name with at least one and at most 'length'
+   * symbols to the given string. Rather than generating names until one
+   * fits, every step is weighted by the chance that the walk can still end
+   * within the remaining length. This samples from the same distribution as
+   * rejecting names that are too long or empty, but always takes exactly one
+   * walk.
+   *
+   * \param[out] out    The string to append the name to.
+   * \param[in]  length The maximum length of the name. Nothing is appended
+   *                    if the table has no names that short.
+   */
+  void append(std::basic_string<T> &out, unsigned int length) {
+    if (length >= table::limit) {
+      std::size_t start = out.size();
+      do {
+        out.resize(start);
+        append(out);
+      } while (out.size() == start);
+      return;
+    }
+
+    unsigned long s = 0;
+
+    for (unsigned int n = 0;; n++) {
+      const auto &st = data.states[s];
+      double total = 0;
+      for (unsigned long i = std::get<0>(st); i < std::get<1>(st); i++) {
+        total += weight(data.transitions[i], n, length);
+      }
+      if (total <= 0) {
+        break;
+      }
+
+      double r = std::uniform_real_distribution<double>(0, total)(rng);
+      unsigned long i = std::get<0>(st);
+      for (; i < std::get<1>(st) - 1; i++) {
+        const double w = weight(data.transitions[i], n, length);
+        if (r < w) {
+          break;
+        }
+        r -= w;
+      }
+      while (weight(data.transitions[i], n, length) <= 0) {
+        i--;
+      }
+
+      const auto &t = data.transitions[i];
+      if (std::get<0>(t) == 0) {
+        break;
+      }
+      out.push_back(T(std::get<0>(t)));
+      s = std::get<2>(t);
+    }
+  }
+
+protected:
+  random &rng;
+  const table &data;
+
+  unsigned long pick(const table::state &s) {
+    std::uniform_int_distribution<unsigned long> d(0, std::get<2>(s) - 1);
+    unsigned long r = d(rng);
+    unsigned long i = std::get<0>(s);
+
+    while (r >= std::get<1>(data.transitions[i])) {
+      r -= std::get<1>(data.transitions[i]);
+      i++;
+    }
+
+    return i;
+  }
+
+  /**\brief Weight of a transition under a length limit
+   *
+   * \param[in] t      The transition.
+   * \param[in] n      How many symbols were emitted so far.
+   * \param[in] length The maximum length of the name.
+   */
+  double weight(const table::transition &t, unsigned int n,
+                unsigned int length) const {
+    if (std::get<0>(t) == 0) {
+      return n > 0 ? std::get<1>(t) : 0;
+    }
+    if (n >= length) {
+      return 0;
+    }
+    return std::get<1>(t) * data.ending(std::get<2>(t), length - n - 1);
+  }
+};
+}
+}
+}
+
+#endif
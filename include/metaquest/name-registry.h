@@ -0,0 +1,240 @@
+/**\file
+ * \brief Name registry
+ *
+ * Contains a set of names that have been handed out, so that generated names
+ * can be kept unique.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_NAME_REGISTRY_H)
+#define METAQUEST_NAME_REGISTRY_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace metaquest {
+namespace name {
+/**\brief Unique name registry
+ *
+ * Remembers names so that they're only handed out once. Names aren't stored
+ * themselves; the registry keeps a 64-bit fingerprint per name in one of a
+ * number of open-addressing tables, which takes between 11 and 22 bytes per
+ * name.
+ * Two different names with the same fingerprint count as the same name, which
+ * only costs an extra retry when generating names.
+ *
+ * A Bloom filter sits in front of the tables. It answers contains() for
+ * names that were never registered without looking at the tables, and it is
+ * updated with atomic operations so that doesn't take a lock. When insert()
+ * sets a bit in the filter that wasn't set before, the name is new, and its
+ * fingerprint goes into the first free slot without comparing it to the
+ * fingerprints already there.
+ *
+ * The tables are split into shards with a mutex each, so threads that
+ * register names at the same time rarely wait for each other. insert() sets
+ * the filter bits while holding the shard's mutex, so two threads that
+ * register the same name can't both see it as new.
+ *
+ * \tparam T The type used for single characters in names.
+ */
+template <typename T = char> class registry {
+public:
+  /**\brief Construct with expected size
+   *
+   * \param[in] pExpected      The number of names the Bloom filter is sized
+   *                           for. More names still work, but contains()
+   *                           takes the fast path less often.
+   * \param[in] pFalsePositive The rate at which the Bloom filter should let
+   *                           new names through to the tables at that size.
+   */
+  registry(std::size_t pExpected = 1 << 20, double pFalsePositive = 0.01)
+      : retries(64), count(0) {
+    const double ln2 = std::log(2.);
+    const double n = std::max<std::size_t>(pExpected, 1);
+    const double m = -n * std::log(pFalsePositive) / (ln2 * ln2);
+
+    std::size_t words = 1;
+    while (words * 64 < m) {
+      words <<= 1;
+    }
+
+    bits = std::vector<std::atomic<std::uint64_t>>(words);
+    mask = words * 64 - 1;
+    hashes = std::max(1, int(std::lround(m / n * ln2)));
+  }
+
+  /**\brief Register a name
+   *
+   * \param[in] n The name to register.
+   *
+   * \returns 'true' if the name was new and has been registered, 'false' if
+   *          it had been registered before.
+   */
+  bool insert(std::basic_string_view<T> n) {
+    const std::uint64_t f = fingerprint(n);
+    auto &s = shards[f % shards.size()];
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    bool fresh = false;
+    for (unsigned int i = 0; i < hashes; i++) {
+      const std::uint64_t b = bit(f, i);
+      const std::uint64_t m = std::uint64_t(1) << (b % 64);
+      if ((bits[b / 64].fetch_or(m, std::memory_order_relaxed) & m) == 0) {
+        fresh = true;
+      }
+    }
+
+    if (s.insert(f, fresh)) {
+      count.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    return false;
+  }
+
+  /**\brief Check for a name
+   *
+   * \param[in] n The name to look for.
+   *
+   * \returns 'true' if the name has been registered.
+   */
+  bool contains(std::basic_string_view<T> n) const {
+    const std::uint64_t f = fingerprint(n);
+
+    for (unsigned int i = 0; i < hashes; i++) {
+      const std::uint64_t b = bit(f, i);
+      if ((bits[b / 64].load(std::memory_order_relaxed) &
+           (std::uint64_t(1) << (b % 64))) == 0) {
+        return false;
+      }
+    }
+
+    const auto &s = shards[f % shards.size()];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.contains(f);
+  }
+
+  /**\brief Attempts per name
+   *
+   * How often generators try to come up with a name that hasn't been
+   * registered before they settle for a duplicate, so that they don't loop
+   * forever once the possible names run out.
+   */
+  unsigned int retries;
+
+  /**\brief Number of registered names */
+  std::size_t size(void) const {
+    return count.load(std::memory_order_relaxed);
+  }
+
+protected:
+  /**\brief Fingerprint table
+   *
+   * An open-addressing hash set of fingerprints; 0 marks an empty slot.
+   * Callers hold 'mutex' while using it.
+   */
+  class shard {
+  public:
+    shard(void) : slots(64), used(0) {}
+
+    /**\brief Add a fingerprint
+     *
+     * \param[in] f     The fingerprint to add.
+     * \param[in] fresh Whether the fingerprint is known not to be in the
+     *                  table yet, so it needn't be looked for.
+     *
+     * \returns 'true' if the fingerprint was added.
+     */
+    bool insert(std::uint64_t f, bool fresh) {
+      if ((used + 1) * 4 > slots.size() * 3) {
+        grow();
+      }
+
+      const std::size_t i = find(f, fresh);
+      if (slots[i] == f) {
+        return false;
+      }
+
+      slots[i] = f;
+      used++;
+      return true;
+    }
+
+    bool contains(std::uint64_t f) const { return slots[find(f)] == f; }
+
+    mutable std::mutex mutex;
+
+  protected:
+    std::vector<std::uint64_t> slots;
+    std::size_t used;
+
+    /**\brief Find a fingerprint's slot
+     *
+     * \param[in] f    The fingerprint to look for.
+     * \param[in] free Whether to skip ahead to the first empty slot without
+     *                 comparing fingerprints.
+     *
+     * \returns The slot that holds 'f', or the empty slot it would go in.
+     */
+    std::size_t find(std::uint64_t f, bool free = false) const {
+      const std::size_t m = slots.size() - 1;
+      std::size_t i = (f >> 16) & m;
+
+      while ((slots[i] != 0) && (free || (slots[i] != f))) {
+        i = (i + 1) & m;
+      }
+
+      return i;
+    }
+
+    void grow(void) {
+      std::vector<std::uint64_t> old(slots.size() * 2);
+      old.swap(slots);
+
+      for (const auto f : old) {
+        if (f != 0) {
+          slots[find(f, true)] = f;
+        }
+      }
+    }
+  };
+
+  std::array<shard, 64> shards;
+  std::vector<std::atomic<std::uint64_t>> bits;
+  std::uint64_t mask;
+  unsigned int hashes;
+  std::atomic<std::size_t> count;
+
+  static std::uint64_t fingerprint(std::basic_string_view<T> n) {
+    std::uint64_t f = std::hash<std::basic_string_view<T>>()(n);
+
+    f += 0x9e3779b97f4a7c15;
+    f = (f ^ (f >> 30)) * 0xbf58476d1ce4e5b9;
+    f = (f ^ (f >> 27)) * 0x94d049bb133111eb;
+    f ^= f >> 31;
+
+    return f != 0 ? f : 1;
+  }
+
+  std::uint64_t bit(std::uint64_t f, unsigned int i) const {
+    return ((f >> 32) + i * ((f & 0xffffffff) | 1)) & mask;
+  }
+};
+}
+}
+
+#endif
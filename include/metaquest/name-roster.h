@@ -0,0 +1,251 @@
+/**\file
+ * \brief Name rosters
+ *
+ * Contains a bulk name generator that writes large numbers of full names into
+ * a single string, for when characters are generated by the party or by the
+ * thousand.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_NAME_ROSTER_H)
+#define METAQUEST_NAME_ROSTER_H
+
+#include <metaquest/name.h>
+
+#include <string_view>
+#include <vector>
+
+namespace metaquest {
+namespace name {
+namespace american {
+/**\brief Roster of American-sounding names
+ *
+ * Generates full names the same way american::proper does - a given name,
+ * sometimes more given names, a family name and sometimes more family names -
+ * but appends them all to one string, separated by spaces, instead of
+ * allocating a string per name. Each name is referred to by an entry with its
+ * offset in that string.
+ *
+ * A roster owns its source, so separate rosters can be used on separate
+ * threads. Rosters may share a registry to keep display names unique.
+ *
+ * \tparam T         The type used for single characters in names.
+ * \tparam generator A class that can generate random names, e.g. a
+ *                   variant of markov::chain or census::sampler.
+ */
+template <typename T = char, typename generator = markov::chain<T>>
+class roster {
+public:
+  typedef typename generator::random random;
+
+  /**\brief Name handle
+   *
+   * Refers to one full name in the roster's text.
+   */
+  class entry {
+  public:
+    /**\brief Position of the first character in the text */
+    std::size_t offset;
+
+    /**\brief Number of characters, including spaces */
+    std::size_t length;
+
+    /**\brief Number of characters in the first given name */
+    unsigned int display;
+
+    /**\brief Number of given names */
+    unsigned int given;
+
+    /**\brief Number of family names */
+    unsigned int family;
+  };
+
+  /**\brief Construct with seed and stream
+   *
+   * \param[in] pSeed   The seed for the roster's source.
+   * \param[in] pStream The stream number for the roster's source.
+   */
+  roster(unsigned long pSeed = seed, unsigned long pStream = 0)
+      : from(pSeed, pStream), unique(nullptr) {}
+
+  /**\brief Make room for names
+   *
+   * Reserves enough space for 'count' more names of the given maximum
+   * length, so that generating them doesn't need to allocate.
+   *
+   * \param[in] count  The number of names to make room for.
+   * \param[in] length The maximum length of each part of the names.
+   */
+  void reserve(std::size_t count, unsigned int length = 9) {
+    text.reserve(text.size() + count * 2 * (length + 1));
+    names.reserve(names.size() + count);
+  }
+
+  /**\brief Generate names of random gender
+   *
+   * \param[in] count  The number of names to generate.
+   * \param[in] length The maximum length of each part of the names.
+   */
+  void generate(std::size_t count, unsigned int length = 9) {
+    reserve(count, length);
+    for (std::size_t i = 0; i < count; i++) {
+      add((from.PRNG() % 2) == 0, length);
+    }
+  }
+
+  /**\brief Generate names
+   *
+   * \param[in] count  The number of names to generate.
+   * \param[in] female Whether to use the census data for female names.
+   * \param[in] length The maximum length of each part of the names.
+   */
+  void generate(std::size_t count, bool female, unsigned int length = 9) {
+    reserve(count, length);
+    for (std::size_t i = 0; i < count; i++) {
+      add(female, length);
+    }
+  }
+
+  /**\brief Number of names */
+  std::size_t size(void) const { return names.size(); }
+
+  /**\brief Remove all names */
+  void clear(void) {
+    text.clear();
+    names.clear();
+  }
+
+  /**\brief Query a full name
+   *
+   * \param[in] i The index of the name.
+   *
+   * \returns All parts of the name, separated by spaces. Only valid until
+   *          the roster is modified.
+   */
+  std::basic_string_view<T> full(std::size_t i) const {
+    const auto &e = names[i];
+    return std::basic_string_view<T>(text.data() + e.offset, e.length);
+  }
+
+  /**\brief Query a display name
+   *
+   * \param[in] i The index of the name.
+   *
+   * \returns The first given name, like proper::display().
+   */
+  std::basic_string_view<T> display(std::size_t i) const {
+    const auto &e = names[i];
+    return std::basic_string_view<T>(text.data() + e.offset, e.display);
+  }
+
+  /**\brief Copy a name out of the roster
+   *
+   * \param[in] i The index of the name.
+   *
+   * \returns The name as a proper name, with its parts tagged as given and
+   *          family names, e.g. to assign to a character.
+   */
+  metaquest::name::proper<T, generator> proper(std::size_t i) const {
+    using part = metaquest::name::name<T, generator>;
+
+    const auto &e = names[i];
+    metaquest::name::proper<T, generator> r;
+    r.reserve(e.given + e.family);
+
+    std::size_t start = e.offset;
+    const std::size_t end = e.offset + e.length;
+    for (unsigned int n = 0; n < e.given + e.family; n++) {
+      std::size_t stop = text.find(T(' '), start);
+      if ((stop == std::basic_string<T>::npos) || (stop > end)) {
+        stop = end;
+      }
+      r.push_back(part(text.substr(start, stop - start),
+                       n < e.given ? part::givenName : part::familyName));
+      start = stop + 1;
+    }
+
+    return r;
+  }
+
+  /**\brief The names
+   *
+   * All generated names, back to back, with spaces between the parts of
+   * each name.
+   */
+  std::basic_string<T> text;
+
+  /**\brief Handles for the names in 'text' */
+  std::vector<entry> names;
+
+  /**\brief The source the names are generated with */
+  source<T, generator> from;
+
+  /**\brief Registry of display names
+   *
+   * If set, the first given name of each generated name is regenerated until
+   * it hasn't been registered there yet, and then registered.
+   */
+  registry<T> *unique;
+
+protected:
+  void add(bool female, unsigned int length) {
+    entry e{text.size(), 0, 0, 0, 0};
+
+    do {
+      const bool f = (from.PRNG() % 10) == 0 ? !female : female;
+      part(f, length, e);
+      if (e.given++ == 0) {
+        if (unique != nullptr) {
+          for (unsigned int i = 1;
+               !unique->insert(std::basic_string_view<T>(
+                   text.data() + e.offset, text.size() - e.offset)) &&
+               (i < unique->retries);
+               i++) {
+            text.resize(e.offset);
+            part(f, length, e);
+          }
+        }
+        e.display = text.size() - e.offset;
+      }
+    } while ((from.PRNG() % 10) == 0);
+
+    do {
+      part(from.lastNames, length, e);
+      e.family++;
+    } while ((from.PRNG() % 10) == 0);
+
+    e.length = text.size() - e.offset;
+    names.push_back(e);
+  }
+
+  void part(bool female, unsigned int length, const entry &e) {
+    part(female ? from.femaleFirstNames : from.maleFirstNames, length, e);
+  }
+
+  void part(generator &g, unsigned int length, const entry &e) {
+    if (text.size() > e.offset) {
+      text.push_back(T(' '));
+    }
+
+    const std::size_t start = text.size();
+    g.append(text, length);
+
+    if (text.size() > start + 1) {
+      std::transform(text.begin() + start + 1, text.end(),
+                     text.begin() + start + 1,
+                     [](T a) -> T { return std::tolower(a); });
+    }
+  }
+};
+}
+}
+}
+
+#endif
@@ -16,14 +16,20 @@
 #if !defined(METAQUEST_NAME_H)
 #define METAQUEST_NAME_H
 
-#include <ef.gy/markov.h>
+#include <metaquest/name-census.h>
+#include <metaquest/name-markov.h>
+#include <metaquest/name-registry.h>
 #include <ef.gy/json.h>
 
-#include <data/female.first.h>
-#include <data/male.first.h>
-#include <data/all.last.h>
+#include <data/female.first.markov.h>
+#include <data/male.first.markov.h>
+#include <data/all.last.markov.h>
+#include <data/female.first.alias.h>
+#include <data/male.first.alias.h>
+#include <data/all.last.alias.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 
 namespace metaquest {
@@ -49,9 +55,9 @@ static const unsigned long seed = std::random_device()();
  *
  * \tparam T         The type used for single characters in names.
  * \tparam generator A class that can generate random names, e.g. a
- *                   variant of efgy::markov::chain.
+ *                   variant of markov::chain or census::sampler.
  */
-template <typename T = char, typename generator = efgy::markov::chain<T, 3>>
+template <typename T = char, typename generator = markov::chain<T>>
 class name {
 public:
   /**\brief Name type
@@ -135,9 +141,9 @@ public:
  *
  * \tparam T         The type used for single characters in names.
  * \tparam generator A class that can generate random names, e.g. a
- *                   variant of efgy::markov::chain.
+ *                   variant of markov::chain or census::sampler.
  */
-template <typename T = char, typename generator = efgy::markov::chain<T, 3>>
+template <typename T = char, typename generator = markov::chain<T>>
 class proper : public std::vector<name<T, generator>> {
 public:
   /**\brief Query the full name
@@ -205,7 +211,7 @@ public:
   }
 };
 
-template <typename T = char, typename generator = efgy::markov::chain<T, 3>>
+template <typename T = char, typename generator = markov::chain<T>>
 class simple : public proper<T, generator> {
 public:
   typedef proper<T, generator> parent;
@@ -219,6 +225,128 @@ public:
  * based on historic census data.
  */
 namespace american {
+/**\brief Female given name transitions
+ *
+ * Trained on the census data for female first names when the data headers
+ * were generated.
+ */
+static const markov::table femaleFirst(data::markov::female_first_states,
+                                       data::markov::female_first_transitions);
+
+/**\brief Male given name transitions */
+static const markov::table maleFirst(data::markov::male_first_states,
+                                     data::markov::male_first_transitions);
+
+/**\brief Family name transitions */
+static const markov::table allLast(data::markov::all_last_states,
+                                   data::markov::all_last_transitions);
+
+/**\brief Data sets for a kind of generator
+ *
+ * Maps the table type of a generator to the tables for the American given
+ * and family names, so that the templates in here work with any generator
+ * that has tables for all three data sets.
+ *
+ * \tparam table The table type of a generator.
+ */
+template <typename table> class tables;
+
+template <> class tables<markov::table> {
+public:
+  static const markov::table &femaleFirst(void) {
+    return american::femaleFirst;
+  }
+
+  static const markov::table &maleFirst(void) { return american::maleFirst; }
+
+  static const markov::table &allLast(void) { return american::allLast; }
+};
+
+template <> class tables<census::table> {
+public:
+  static const census::table &femaleFirst(void) {
+    static const census::table t(data::alias::female_first);
+    return t;
+  }
+
+  static const census::table &maleFirst(void) {
+    static const census::table t(data::alias::male_first);
+    return t;
+  }
+
+  static const census::table &allLast(void) {
+    static const census::table t(data::alias::all_last);
+    return t;
+  }
+};
+
+/**\brief Name source
+ *
+ * The sampling state for generating American names: a PRNG and generators
+ * for the given and family name data sets. The trained tables are shared by
+ * all sources, but each source has its own PRNG, so sources can be used on
+ * different threads at the same time as long as each one is only used by one
+ * thread.
+ *
+ * A source is seeded from a seed and a stream number, so the same seed and
+ * stream always produce the same names, while different streams don't
+ * overlap.
+ *
+ * \tparam T         The type used for single characters in names.
+ * \tparam generator A class that can generate random names, e.g. a
+ *                   variant of markov::chain or census::sampler.
+ */
+template <typename T = char, typename generator = markov::chain<T>>
+class source {
+public:
+  typedef typename generator::random random;
+  typedef tables<typename generator::table> sets;
+
+  /**\brief Construct with seed and stream
+   *
+   * \param[in] pSeed   The seed shared by a set of streams.
+   * \param[in] pStream The number of this stream.
+   */
+  source(unsigned long pSeed = seed, unsigned long pStream = 0)
+      : femaleFirstNames(PRNG, sets::femaleFirst()),
+        maleFirstNames(PRNG, sets::maleFirst()),
+        lastNames(PRNG, sets::allLast()) {
+    reseed(pSeed, pStream);
+  }
+
+  source(const source &) = delete;
+  source &operator=(const source &) = delete;
+
+  /**\brief Restart with a new seed and stream
+   *
+   * \param[in] pSeed   The seed shared by a set of streams.
+   * \param[in] pStream The number of this stream.
+   */
+  void reseed(unsigned long pSeed, unsigned long pStream) {
+    std::seed_seq s{pSeed, pStream};
+    PRNG.seed(s);
+  }
+
+  /**\brief The calling thread's source
+   *
+   * Every thread that generates names without passing a source gets its own,
+   * seeded with the default seed and the next free stream number. Use
+   * reseed() on it to make a thread's names reproducible.
+   *
+   * \returns The calling thread's source.
+   */
+  static source &local(void) {
+    static std::atomic<unsigned long> streams(0);
+    thread_local source s(seed, streams.fetch_add(1));
+    return s;
+  }
+
+  random PRNG;
+  generator femaleFirstNames;
+  generator maleFirstNames;
+  generator lastNames;
+};
+
 /**\brief Automatically-generated, American-sounding given name
  *
  * This template can be used to automatically generate American-ish
@@ -226,9 +354,9 @@ namespace american {
  *
  * \tparam T         The type used for single characters in names.
  * \tparam generator A class that can generate random names, e.g. a
- *                   variant of efgy::markov::chain.
+ *                   variant of markov::chain or census::sampler.
  */
-template <typename T = char, typename generator = efgy::markov::chain<T, 3>>
+template <typename T = char, typename generator = markov::chain<T>>
 class given : public name<T, generator> {
 public:
   /**\brief Base name type
@@ -251,27 +379,36 @@ public:
    * \param[in] female Whether the code should use the census
    *                   data for female names; Defaults to
    *                   'true'.
-   * \param[in] length The maximum length of the name. If the
-   *                   generated name is longer then a new one
-   *                   is generated.
+   * \param[in] length The maximum length of the name. The name
+   *                   is generated within this limit in a single
+   *                   walk of the chain.
    */
   given(bool female = true, unsigned int length = 9)
+      : given(source<T, generator>::local(), female, length) {}
+
+  /**\brief Construct with source, gender and maximum length
+   *
+   * Like the other constructor, but draws from the given source
+   * instead of the calling thread's.
+   *
+   * \param[in] from   The source to generate the name with.
+   * \param[in] female Whether the code should use the census
+   *                   data for female names.
+   * \param[in] length The maximum length of the name.
+   */
+  given(source<T, generator> &from, bool female, unsigned int length = 9)
       : parent("", parent::givenName) {
-    static typename generator::random PRNG(seed);
-    static generator femaleFirstNames(PRNG, data::female_first);
-    static generator maleFirstNames(PRNG, data::male_first);
-
-    while ((value.size() == 0) || (value.size() > length)) {
-      switch (PRNG() % 10) {
-      case 0:
-        (female ? maleFirstNames : femaleFirstNames) >> value;
-      default:
-        (female ? femaleFirstNames : maleFirstNames) >> value;
-      }
+    if ((from.PRNG() % 10) == 0) {
+      female = !female;
     }
 
-    std::transform(value.begin() + 1, value.end(), value.begin() + 1,
-                   [](char a) -> char { return std::tolower(a); });
+    (female ? from.femaleFirstNames : from.maleFirstNames)
+        .append(value, length);
+
+    if (value.size() > 1) {
+      std::transform(value.begin() + 1, value.end(), value.begin() + 1,
+                     [](char a) -> char { return std::tolower(a); });
+    }
   }
 };
 
@@ -282,9 +419,9 @@ public:
  *
  * \tparam T         The type used for single characters in names.
  * \tparam generator A class that can generate random names, e.g. a
- *                   variant of efgy::markov::chain.
+ *                   variant of markov::chain or census::sampler.
  */
-template <typename T = char, typename generator = efgy::markov::chain<T, 3>>
+template <typename T = char, typename generator = markov::chain<T>>
 class family : public name<T, generator> {
 public:
   /**\copydoc given::name */
@@ -299,20 +436,29 @@ public:
    * limit on the length of that name so as to make sure the
    * names don't get too unwieldy.
    *
-   * \param[in] length The maximum length of the name. If the
-   *                   generated name is longer then a new one
-   *                   is generated.
+   * \param[in] length The maximum length of the name. The name
+   *                   is generated within this limit in a single
+   *                   walk of the chain.
    */
-  family(unsigned int length = 9) : parent("", parent::familyName) {
-    static typename generator::random PRNG(seed);
-    static generator lastNames(PRNG, data::all_last);
+  family(unsigned int length = 9)
+      : family(source<T, generator>::local(), length) {}
 
-    while ((value.size() == 0) || (value.size() > length)) {
-      lastNames >> value;
-    }
+  /**\brief Construct with source and maximum length
+   *
+   * Like the other constructor, but draws from the given source
+   * instead of the calling thread's.
+   *
+   * \param[in] from   The source to generate the name with.
+   * \param[in] length The maximum length of the name.
+   */
+  family(source<T, generator> &from, unsigned int length = 9)
+      : parent("", parent::familyName) {
+    from.lastNames.append(value, length);
 
-    std::transform(value.begin() + 1, value.end(), value.begin() + 1,
-                   [](char a) -> char { return std::tolower(a); });
+    if (value.size() > 1) {
+      std::transform(value.begin() + 1, value.end(), value.begin() + 1,
+                     [](char a) -> char { return std::tolower(a); });
+    }
   }
 };
 
@@ -323,9 +469,9 @@ public:
  *
  * \tparam T         The type used for single characters in names.
  * \tparam generator A class that can generate random names, e.g. a
- *                   variant of efgy::markov::chain.
+ *                   variant of markov::chain or census::sampler.
  */
-template <typename T = char, typename generator = efgy::markov::chain<T, 3>>
+template <typename T = char, typename generator = markov::chain<T>>
 class proper : public metaquest::name::proper<T, generator> {
 public:
   /**\copydoc given::name */
@@ -341,22 +487,44 @@ public:
    * \param[in] female Whether the code should use the census
    *                   data for female names; Defaults to
    *                   'true'.
-   * \param[in] length The maximum length of the name. If the
-   *                   generated name is longer then a new one
-   *                   is generated.
+   * \param[in] length The maximum length of each of the
+   *                   names.
    */
-  proper(bool female = true, unsigned int length = 9) {
-    static typename generator::random PRNG(seed);
+  proper(bool female = true, unsigned int length = 9)
+      : proper(source<T, generator>::local(), female, length) {}
 
+  /**\brief Construct with source, gender and maximum length
+   *
+   * Like the other constructor, but draws from the given source
+   * instead of the calling thread's.
+   *
+   * \param[in] from   The source to generate the names with.
+   * \param[in] female Whether the code should use the census
+   *                   data for female names.
+   * \param[in] length The maximum length of each of the
+   *                   names.
+   * \param[in] unique If set, the first given name - the one
+   *                   that display() returns - is regenerated
+   *                   until it hasn't been registered there
+   *                   yet, and then registered.
+   */
+  proper(source<T, generator> &from, bool female, unsigned int length = 9,
+         registry<T> *unique = nullptr) {
     do {
-      given<T, generator> f(female, length);
+      given<T, generator> f(from, female, length);
+      if ((unique != nullptr) && parent::empty()) {
+        for (unsigned int i = 1;
+             !unique->insert(f.value) && (i < unique->retries); i++) {
+          f = given<T, generator>(from, female, length);
+        }
+      }
       parent::push_back(f);
-    } while ((PRNG() % 10) == 0);
+    } while ((from.PRNG() % 10) == 0);
 
     do {
-      family<T, generator> l(length);
+      family<T, generator> l(from, length);
       parent::push_back(l);
-    } while ((PRNG() % 10) == 0);
+    } while ((from.PRNG() % 10) == 0);
   }
 };
 }
@@ -20,6 +20,7 @@
 
 #include <metaquest/name.h>
 
+#include <atomic>
 #include <optional>
 #include <string>
 #include <map>
@@ -31,6 +32,17 @@
 namespace metaquest {
 template <typename T> using slots = std::map<std::string, T>;
 
+/**\brief Next revision number
+ *
+ * \returns A number that no earlier call returned, so things that are stamped
+ *          with one can tell whether anything changed since they were last
+ *          looked at.
+ */
+static inline std::size_t revision(void) {
+  static std::atomic<std::size_t> last(0);
+  return ++last;
+}
+
 /**\brief A game object
  *
  * The base class for items, characters, etc. Provides common properties,
@@ -97,6 +109,7 @@ public:
         }
       }
     }
+    revision = metaquest::revision();
     return attribute[s] = n;
   }
 
@@ -155,6 +168,7 @@ public:
       slots[data.first] = data.second.asNumber();
     }
 
+    revision = metaquest::revision();
     return true;
   }
 
@@ -190,6 +204,13 @@ public:
    * Maps basic attributes to their proper values.
    */
   std::map<std::string, T> attribute;
+
+  /**\brief Attribute revision
+   *
+   * Renewed whenever set() or load() change the attributes, so anything that
+   * is derived from them can be kept until this changes.
+   */
+  std::size_t revision = metaquest::revision();
 };
 
 template <typename T> using objects = std::vector<object<T> *>;
@@ -0,0 +1,95 @@
+/**\file
+ * \brief Lock-free queues
+ *
+ * Contains a bounded queue for handing data from one thread to another
+ * without taking locks.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_QUEUE_H)
+#define METAQUEST_QUEUE_H
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace metaquest {
+/**\brief Single-producer, single-consumer queue
+ *
+ * A bounded ring buffer that one thread may push() to while another thread
+ * pop()s from it, without either of them taking a lock. Using either end
+ * from more than one thread at a time is not safe.
+ *
+ * \tparam T The element type; needs to be default-constructible and movable.
+ */
+template <typename T> class queue {
+public:
+  /**\brief Construct with capacity
+   *
+   * \param[in] pCapacity The maximum number of queued elements; rounded up to
+   *                      the next power of two.
+   */
+  queue(std::size_t pCapacity = 1024) : head(0), tail(0) {
+    std::size_t c = 1;
+    while (c < pCapacity) {
+      c <<= 1;
+    }
+    slots.resize(c);
+    mask = c - 1;
+  }
+
+  /**\brief Add an element
+   *
+   * Producer side only.
+   *
+   * \param[in] value The element to add; only moved from if there was room.
+   *
+   * \returns 'false' if the queue was full.
+   */
+  bool push(T &&value) {
+    const auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size()) {
+      return false;
+    }
+
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**\brief Take the oldest element
+   *
+   * Consumer side only.
+   *
+   * \param[out] value Set to the element that was taken off the queue.
+   *
+   * \returns 'false' if the queue was empty.
+   */
+  bool pop(T &value) {
+    const auto h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    value = std::move(slots[h & mask]);
+    slots[h & mask] = T();
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+protected:
+  std::vector<T> slots;
+  std::size_t mask;
+  std::atomic<std::size_t> head;
+  std::atomic<std::size_t> tail;
+};
+}
+
+#endif
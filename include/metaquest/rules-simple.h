@@ -18,13 +18,14 @@
 
 #include <metaquest/character.h>
 #include <metaquest/game.h>
+#include <metaquest/name-roster.h>
 #include <random>
 
 namespace metaquest {
 namespace rules {
 namespace simple {
 static long solve(double a, double b, double c) {
-  static std::mt19937 rng = std::mt19937(std::random_device()());
+  thread_local std::mt19937 rng = std::mt19937(std::random_device()());
   return 5 * std::sqrt(a * b / c) * (0.95 + (rng() % 100) / 1000.0);
 }
 
@@ -94,7 +95,7 @@ static std::string pass(objects<long> &source, objects<long> &target) {
 using action = metaquest::action<long>;
 
 static metaquest::item<long> weapon(const std::string &name) {
-  static std::mt19937 rng = std::mt19937(std::random_device()());
+  thread_local std::mt19937 rng = std::mt19937(std::random_device()());
   metaquest::item<long> r;
 
   r.usedSlots["Weapon"] = 1;
@@ -106,11 +107,11 @@ static metaquest::item<long> weapon(const std::string &name) {
   return r;
 }
 
-static metaquest::character<long> character(long points = 0) {
-  static std::mt19937 rng = std::mt19937(std::random_device()());
+static metaquest::character<long> character(long points,
+                                            const name::proper<> &cname) {
+  thread_local std::mt19937 rng = std::mt19937(std::random_device()());
   metaquest::character<long> c;
 
-  metaquest::name::american::proper<> cname(rng() % 2);
   c.name = cname;
 
   c.slots = {{"Weapon", 1}, {"Trinket", 1}};
@@ -137,6 +138,11 @@ static metaquest::character<long> character(long points = 0) {
   return c;
 }
 
+static metaquest::character<long> character(long points = 0) {
+  thread_local std::mt19937 rng = std::mt19937(std::random_device()());
+  return character(points, name::american::proper<>(rng() % 2));
+}
+
 template <typename inter>
 class game : public metaquest::game::base<long, inter> {
 public:
@@ -158,10 +164,18 @@ public:
     return simple::character(points);
   }
 
+  virtual character generateCharacter(long points, const name::proper<> &n) {
+    return simple::character(points, n);
+  }
+
   virtual party generateParty(long members, long points) {
-    static std::mt19937 rng = std::mt19937(std::random_device()());
+    thread_local std::mt19937 rng = std::mt19937(std::random_device()());
+    thread_local name::american::roster<> names(rng());
     party p;
 
+    names.clear();
+    names.generate(members);
+
     if ((parent::parties.size() > 0) && (points == 0)) {
       for (auto &c : parent::parties[0]) {
         points += c["Experience"];
@@ -174,7 +188,7 @@ public:
         cpoints = rng() % points;
         points -= cpoints;
       }
-      p.push_back(generateCharacter(cpoints));
+      p.push_back(generateCharacter(cpoints, names.proper(i)));
     }
 
     return p;
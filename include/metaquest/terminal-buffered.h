@@ -0,0 +1,234 @@
+/**\file
+ * \brief Buffered terminal output
+ *
+ * Contains a VT100 terminal that assembles each frame into a single buffer,
+ * and writes that out in one go.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_TERMINAL_BUFFERED_H)
+#define METAQUEST_TERMINAL_BUFFERED_H
+
+#include <terminalxx/vt100.h>
+
+#include <string>
+#include <functional>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+namespace metaquest {
+namespace interact {
+namespace terminal {
+/**\brief Frame encoder
+ *
+ * Turns a sequence of cell updates into the escape sequences needed to put
+ * them on a VT100-compatible terminal. The encoder keeps track of where the
+ * cursor is and which colours are set, so it only emits cursor movements and
+ * SGR sequences when they actually change anything. The output buffer is
+ * reused between frames.
+ *
+ * \tparam T The type used for cell contents, i.e. code points.
+ */
+template <typename T = long> class frame {
+public:
+  frame(void) { reset(); }
+
+  /**\brief Start a new frame
+   *
+   * Clears the buffer, and forgets about the cursor position and colours, as
+   * something else may have written to the terminal in the meantime.
+   */
+  void reset(void) {
+    buffer.clear();
+    line = column = -1;
+    foreground = background = -1;
+  }
+
+  /**\brief Add a cell update
+   *
+   * \param[in] l    The line of the cell.
+   * \param[in] c    The column of the cell.
+   * \param[in] cell The new cell contents.
+   */
+  template <typename C>
+  void put(const std::size_t &l, const std::size_t &c, const C &cell) {
+    move(l, c);
+    colour(cell.foregroundColour, cell.backgroundColour);
+    encode(cell.content);
+    column++;
+  }
+
+  std::string buffer;
+
+protected:
+  long line;
+  long column;
+  long foreground;
+  long background;
+
+  void move(const std::size_t &l, const std::size_t &c) {
+    if (((long)l == line) && ((long)c == column)) {
+      return;
+    }
+
+    if (((long)l == line) && ((long)c > column) && (column >= 0)) {
+      buffer += "\x1b[" + std::to_string(c - column) + "C";
+    } else {
+      buffer +=
+          "\x1b[" + std::to_string(l + 1) + ";" + std::to_string(c + 1) + "H";
+    }
+
+    line = l;
+    column = c;
+  }
+
+  static std::string sgr(long colour, long base, long bright) {
+    if (colour < 8) {
+      return std::to_string(base + colour);
+    } else if (colour < 16) {
+      return std::to_string(bright + colour - 8);
+    }
+    return std::to_string(base + 8) + ";5;" + std::to_string(colour);
+  }
+
+  void colour(long fg, long bg) {
+    if ((fg == foreground) && (bg == background)) {
+      return;
+    }
+
+    buffer += "\x1b[";
+    if (fg != foreground) {
+      buffer += sgr(fg, 30, 90);
+    }
+    if (bg != background) {
+      if (fg != foreground) {
+        buffer += ";";
+      }
+      buffer += sgr(bg, 40, 100);
+    }
+    buffer += "m";
+
+    foreground = fg;
+    background = bg;
+  }
+
+  void encode(const T &content) {
+    const unsigned long cp = content;
+
+    if (cp < 0x80) {
+      buffer += char(cp);
+    } else if (cp < 0x800) {
+      buffer += char(0xc0 | (cp >> 6));
+      buffer += char(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      buffer += char(0xe0 | (cp >> 12));
+      buffer += char(0x80 | ((cp >> 6) & 0x3f));
+      buffer += char(0x80 | (cp & 0x3f));
+    } else {
+      buffer += char(0xf0 | (cp >> 18));
+      buffer += char(0x80 | ((cp >> 12) & 0x3f));
+      buffer += char(0x80 | ((cp >> 6) & 0x3f));
+      buffer += char(0x80 | (cp & 0x3f));
+    }
+  }
+};
+
+/**\brief VT100 terminal with buffered frames
+ *
+ * Works just like terminalxx::vt100, except that flush() compares the whole
+ * screen first and then writes all the changes with a single write() call,
+ * instead of emitting them cell by cell.
+ *
+ * \tparam T The type used for cell contents, i.e. code points.
+ */
+template <typename T = long> class buffered : public terminalxx::vt100<T> {
+public:
+  using parent = terminalxx::vt100<T>;
+  using base = typename parent::base;
+  using cell = typename parent::cell;
+  using command = typename parent::command;
+
+  buffered(int pFD = STDOUT_FILENO) : parent(), fd(pFD), bytes(0) {}
+
+  /**\brief Write changed cells to the terminal
+   *
+   * \param[in] postProcess Called for every cell to get the contents it
+   *                        should be displayed with.
+   *
+   * \returns 'false', as the whole screen is always flushed in one go.
+   */
+  bool flush(std::function<cell(const base &, const std::size_t &,
+                                const std::size_t &)> postProcess) {
+    output.reset();
+
+    for (std::size_t l = 0; l < this->target.size(); l++) {
+      auto &current = this->current[l];
+      for (std::size_t c = 0; c < this->target[l].size(); c++) {
+        const cell v = postProcess(*this, l, c);
+        if (v != current[c]) {
+          output.put(l, c, v);
+          current[c] = v;
+        }
+      }
+    }
+
+    bytes = output.buffer.size();
+
+    for (std::size_t o = 0; o < output.buffer.size();) {
+      const auto r =
+          ::write(fd, output.buffer.data() + o, output.buffer.size() - o);
+      if (r > 0) {
+        o += r;
+      } else if ((r < 0) && (errno == EINTR)) {
+        continue;
+      } else if ((r < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+        pollfd p{fd, POLLOUT, 0};
+        if ((::poll(&p, 1, -1) < 0) && (errno != EINTR)) {
+          break;
+        }
+      } else {
+        break;
+      }
+    }
+
+    return false;
+  }
+
+  /**\brief Bytes queued for output
+   *
+   * \returns The number of bytes the terminal hasn't sent yet, or zero if
+   *          the system doesn't say.
+   */
+  std::size_t backlog(void) const {
+#if defined(TIOCOUTQ)
+    int n = 0;
+    if (::ioctl(fd, TIOCOUTQ, &n) == 0 && n > 0) {
+      return n;
+    }
+#endif
+    return 0;
+  }
+
+  /**\brief Output file descriptor */
+  const int fd;
+
+  /**\brief Size of the last frame, in bytes */
+  std::size_t bytes;
+
+protected:
+  frame<T> output;
+};
+}
+}
+}
+
+#endif
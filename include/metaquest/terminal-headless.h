@@ -0,0 +1,278 @@
+/**\file
+ * \brief Headless terminal
+ *
+ * Contains a terminal that renders into memory instead of a TTY, for use in
+ * automated runs and for recording sessions.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_TERMINAL_HEADLESS_H)
+#define METAQUEST_TERMINAL_HEADLESS_H
+
+#include <terminalxx/vt100.h>
+#include <metaquest/terminal-buffered.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace metaquest {
+namespace interact {
+namespace terminal {
+/**\brief Headless terminal
+ *
+ * A terminal with a fixed size that keeps its cells in memory and never
+ * touches a TTY. Input comes from a script that can be fed in at any time,
+ * and frames can optionally be recorded in the asciicast v2 format, with the
+ * same escape sequences the buffered terminal would have written.
+ *
+ * Use it in place of the default terminal type, e.g. as
+ * interact::terminal::base<headless<>>.
+ *
+ * \tparam T The type used for cell contents, i.e. code points.
+ */
+template <typename T = long>
+class headless : public terminalxx::vt100<T>::base {
+public:
+  using base = typename terminalxx::vt100<T>::base;
+  using cell = typename terminalxx::vt100<T>::cell;
+  using command = typename terminalxx::vt100<T>::command;
+
+  /**\brief Thrown by read() when the closed input script has run out */
+  class exhausted : public std::runtime_error {
+  public:
+    exhausted(void) : std::runtime_error("headless input script exhausted") {}
+  };
+
+  headless(const std::array<std::size_t, 2> &pDimensions = {{80, 24}})
+      : base(), dimensions(pDimensions), bytes(0), recording(nullptr),
+        closed(false) {}
+
+  /**\brief Terminal size
+   *
+   * \returns The dimensions the terminal was created with, as there is no
+   *          actual terminal to ask.
+   */
+  std::array<std::size_t, 2> getOSDimensions(void) const {
+    return dimensions;
+  }
+
+  /**\brief Update the in-memory screen
+   *
+   * Applies the post-processed cells to the current screen and, if a
+   * recording is running, appends the frame to it.
+   *
+   * \param[in] postProcess Called for every cell to get the contents it
+   *                        should be displayed with.
+   *
+   * \returns 'false', as the whole screen is always flushed in one go.
+   */
+  bool flush(std::function<cell(const base &, const std::size_t &,
+                                const std::size_t &)> postProcess) {
+    output.reset();
+
+    for (std::size_t l = 0; l < this->target.size(); l++) {
+      auto &current = this->current[l];
+      for (std::size_t c = 0; c < this->target[l].size(); c++) {
+        const cell v = postProcess(*this, l, c);
+        if (v != current[c]) {
+          output.put(l, c, v);
+          current[c] = v;
+        }
+      }
+    }
+
+    bytes = output.buffer.size();
+
+    std::lock_guard<std::mutex> lock(recordingMutex);
+    if (recording && (bytes > 0)) {
+      const std::chrono::duration<double> t =
+          std::chrono::steady_clock::now() - recordingSince;
+      *recording << "[" << t.count() << ", \"o\", \"" << escape(output.buffer)
+                 << "\"]\n";
+    }
+
+    return false;
+  }
+
+  /**\brief Start recording
+   *
+   * Writes an asciicast v2 header to the given stream, followed by one
+   * output event per frame from then on. Safe to call while the refresher
+   * is flushing frames.
+   *
+   * \param[out] stream Where to write the recording to; must stay valid until
+   *                    the terminal is destroyed.
+   */
+  void record(std::ostream &stream) {
+    std::lock_guard<std::mutex> lock(recordingMutex);
+
+    recording = &stream;
+    recordingSince = std::chrono::steady_clock::now();
+
+    *recording << "{\"version\": 2, \"width\": " << dimensions[0]
+               << ", \"height\": " << dimensions[1] << ", \"timestamp\": "
+               << std::chrono::duration_cast<std::chrono::seconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count()
+               << "}\n";
+  }
+
+  /**\brief Queue scripted input
+   *
+   * Adds keystrokes to the input script. Cursor keys may be given as their
+   * VT100 escape sequences, e.g. "\x1b[B" for 'down'. Safe to call from any
+   * thread.
+   *
+   * \param[in] input The keystrokes to add.
+   */
+  void script(const std::string &input) {
+    {
+      std::lock_guard<std::mutex> lock(inputMutex);
+
+      for (std::size_t i = 0; i < input.size(); i++) {
+        if ((input[i] == '\x1b') && (i + 2 < input.size()) &&
+            (input[i + 1] == '[')) {
+          command c;
+          c.code = input[i + 2];
+          pending.push_back({true, c, 0});
+          i += 2;
+        } else {
+          pending.push_back(
+              {false, command(), T((unsigned char)input[i])});
+        }
+      }
+    }
+    inputAvailable.notify_all();
+  }
+
+  /**\brief End the input script
+   *
+   * After this, read() throws an 'exhausted' exception once the script has
+   * run out.
+   */
+  void close(void) {
+    {
+      std::lock_guard<std::mutex> lock(inputMutex);
+      closed = true;
+    }
+    inputAvailable.notify_all();
+  }
+
+  /**\brief Read a keystroke
+   *
+   * Takes the next event off the input script and hands it to the matching
+   * handler, waiting for more input if the script has run out.
+   *
+   * \param[in] onCommand Called for cursor keys and other commands.
+   * \param[in] onChar    Called for regular keys.
+   *
+   * \returns The return value of the handler.
+   *
+   * \throws exhausted If the script was closed and has run out. Queries keep
+   *                   reading until they get an answer, so they would spin
+   *                   forever otherwise.
+   */
+  bool read(std::function<bool(const command &)> onCommand,
+            std::function<bool(const T &)> onChar) {
+    event e;
+
+    {
+      std::unique_lock<std::mutex> lock(inputMutex);
+      inputAvailable.wait(
+          lock, [this]() -> bool { return closed || !pending.empty(); });
+
+      if (pending.empty()) {
+        throw exhausted();
+      }
+
+      e = pending.front();
+      pending.pop_front();
+    }
+
+    return e.isCommand ? onCommand(e.cmd) : onChar(e.key);
+  }
+
+  /**\brief Terminal size */
+  const std::array<std::size_t, 2> dimensions;
+
+  /**\brief Size of the last frame, in bytes */
+  std::size_t bytes;
+
+protected:
+  class event {
+  public:
+    bool isCommand;
+    command cmd;
+    T key;
+  };
+
+  frame<T> output;
+
+  /**\brief Recording stream and start time
+   *
+   * Set by record() on the game thread and used by flush() on the refresher
+   * thread, so both hold 'recordingMutex' while using them.
+   */
+  std::ostream *recording;
+  std::chrono::steady_clock::time_point recordingSince;
+  std::mutex recordingMutex;
+
+  std::deque<event> pending;
+  std::mutex inputMutex;
+  std::condition_variable inputAvailable;
+  bool closed;
+
+  static std::string escape(const std::string &s) {
+    static const char *hex = "0123456789abcdef";
+    std::string r;
+
+    for (const char &c : s) {
+      switch (c) {
+      case '"':
+        r += "\\\"";
+        break;
+      case '\\':
+        r += "\\\\";
+        break;
+      case '\n':
+        r += "\\n";
+        break;
+      case '\r':
+        r += "\\r";
+        break;
+      case '\t':
+        r += "\\t";
+        break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          r += "\\u00";
+          r += hex[(c >> 4) & 0xf];
+          r += hex[c & 0xf];
+        } else {
+          r += c;
+        }
+      }
+    }
+
+    return r;
+  }
+};
+}
+}
+}
+
+#endif
@@ -0,0 +1,122 @@
+/**\file
+ * \brief Frame pacing
+ *
+ * Contains the frame rate control the terminal interaction uses to avoid
+ * sending frames faster than the terminal can take them.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_TERMINAL_PACER_H)
+#define METAQUEST_TERMINAL_PACER_H
+
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+
+namespace metaquest {
+namespace interact {
+namespace terminal {
+/**\brief Adaptive frame pacer
+ *
+ * Keeps moving averages of how long frames take to write and how many bytes
+ * per second the terminal accepts, and derives the minimum time between two
+ * frames from that. On a local terminal this stays at 'minimum'; on a slow
+ * link it grows so that writing frames only takes up a fraction of the time,
+ * and it backs off further while the terminal's output queue isn't draining.
+ *
+ * Animators are drawn based on the current time rather than frame counts, so
+ * a longer interval simply skips the frames in between.
+ */
+class pacer {
+public:
+  using duration = std::chrono::steady_clock::duration;
+
+  pacer(duration pMinimum = std::chrono::milliseconds(8),
+        duration pMaximum = std::chrono::milliseconds(250))
+      : minimum(pMinimum), maximum(pMaximum), weight(.2), headroom(4),
+        latency(0), throughput(0), backlog(0), backoff(1) {}
+
+  /**\brief Record a frame
+   *
+   * \param[in] write    How long it took to write the frame.
+   * \param[in] bytes    The size of the frame.
+   * \param[in] pBacklog Bytes still waiting to be sent to the terminal.
+   */
+  void add(duration write, std::size_t bytes, std::size_t pBacklog) {
+    const double seconds = std::chrono::duration<double>(write).count();
+
+    latency = weight * seconds + (1 - weight) * latency;
+    if ((bytes > 0) && (seconds > 0)) {
+      throughput = weight * (bytes / seconds) + (1 - weight) * throughput;
+    }
+
+    backlog = pBacklog;
+    backoff = backlog > 0 ? std::min(backoff * 2, 64.)
+                          : std::max(1., backoff * .75);
+  }
+
+  /**\brief Minimum time between frames */
+  duration interval(void) const {
+    double seconds = headroom * latency;
+    if ((backlog > 0) && (throughput > 0)) {
+      seconds = std::max(seconds, backlog / throughput);
+    }
+
+    const auto d = std::chrono::duration_cast<duration>(
+        std::chrono::duration<double>(seconds * backoff));
+
+    return std::min(maximum, std::max(minimum, d));
+  }
+
+  /**\brief Lower bound for interval() */
+  duration minimum;
+
+  /**\brief Upper bound for interval() */
+  duration maximum;
+
+  /**\brief Weight of the latest frame in the moving averages */
+  double weight;
+
+  /**\brief Frame interval as a multiple of the write latency */
+  double headroom;
+
+  /**\brief Average time to write a frame, in seconds */
+  double latency;
+
+  /**\brief Average write throughput, in bytes per second */
+  double throughput;
+
+protected:
+  std::size_t backlog;
+  double backoff;
+};
+
+/**\brief Output backlog of a terminal
+ *
+ * Terminals that can tell how many bytes are still queued for output expose
+ * this as backlog(); for all others this reports zero.
+ */
+template <typename term, typename = void> class frameBacklog {
+public:
+  static std::size_t get(const term &) { return 0; }
+};
+
+template <typename term>
+class frameBacklog<term,
+                   std::void_t<decltype(std::declval<term>().backlog())>> {
+public:
+  static std::size_t get(const term &t) { return t.backlog(); }
+};
+}
+}
+}
+
+#endif
@@ -0,0 +1,227 @@
+/**\file
+ * \brief Render statistics
+ *
+ * Contains the rolling histograms the terminal interaction uses to keep track
+ * of how long it takes to draw frames.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#if !defined(METAQUEST_TERMINAL_STATISTICS_H)
+#define METAQUEST_TERMINAL_STATISTICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace metaquest {
+namespace interact {
+namespace terminal {
+/**\brief Rolling sample window
+ *
+ * Keeps the most recent samples of a measurement, so that quantiles and a
+ * histogram reflect current behaviour rather than the whole session.
+ */
+class rolling {
+public:
+  rolling(std::size_t pWindow = 512) : window(pWindow), count(0), next(0) {}
+
+  void add(double value) {
+    if (samples.size() < window) {
+      samples.push_back(value);
+    } else {
+      samples[next] = value;
+    }
+    next = (next + 1) % window;
+    count++;
+  }
+
+  double quantile(double q) const {
+    if (samples.empty()) {
+      return 0;
+    }
+
+    std::vector<double> s = samples;
+    const auto n = std::min<std::size_t>(q * s.size(), s.size() - 1);
+    std::nth_element(s.begin(), s.begin() + n, s.end());
+    return s[n];
+  }
+
+  double mean(void) const {
+    double sum = 0;
+    for (const auto &s : samples) {
+      sum += s;
+    }
+    return samples.empty() ? 0 : sum / samples.size();
+  }
+
+  double max(void) const {
+    return samples.empty() ? 0
+                           : *std::max_element(samples.begin(), samples.end());
+  }
+
+  /**\brief Histogram of the window
+   *
+   * Sorts the samples into power-of-two buckets: the first bucket holds all
+   * samples below 1, bucket n those in [2^(n-1), 2^n), and the last bucket
+   * everything that doesn't fit anywhere else.
+   *
+   * \returns The number of samples in each bucket.
+   */
+  std::array<std::size_t, 24> histogram(void) const {
+    std::array<std::size_t, 24> h{};
+
+    for (const auto &s : samples) {
+      std::size_t b = s < 1 ? 0 : 1 + std::size_t(std::log2(s));
+      h[std::min(b, h.size() - 1)]++;
+    }
+
+    return h;
+  }
+
+  /**\brief Number of samples in the window */
+  std::size_t size(void) const { return samples.size(); }
+
+  const std::size_t window;
+
+  /**\brief Number of samples ever added */
+  std::size_t count;
+
+protected:
+  std::vector<double> samples;
+  std::size_t next;
+};
+
+/**\brief Frame statistics
+ *
+ * Per-frame measurements taken by the refresher thread. Times are in
+ * microseconds. Only the refresher thread updates these, so they must only be
+ * read from there or after it has finished. The exception is 'overlay'.
+ */
+class statistics {
+public:
+  /**\brief Time spent updating animators, per frame */
+  rolling refresh;
+
+  /**\brief Time spent applying animators to cells, per frame */
+  rolling postProcess;
+
+  /**\brief Time spent writing the frame to the terminal, per frame
+   *
+   * This is only the terminal's flush, without post-processing and without
+   * collecting damage beforehand. The refresher applies render commands
+   * itself, so there is no lock to wait for in here.
+   */
+  rolling flush;
+
+  /**\brief Render commands applied, per frame */
+  rolling commands;
+
+  /**\brief Bytes written to the terminal, per frame */
+  rolling bytes;
+
+  /**\brief Active animators, per frame */
+  rolling animators;
+
+  /**\brief Minimum frame interval chosen by the pacer, per frame */
+  rolling interval;
+
+  /**\brief Whether to measure refresh and post-processing times
+   *
+   * Taking those measurements costs clock reads on every frame, so they're
+   * only taken when this is set, e.g. for --render-statistics, or while the
+   * overlay is shown.
+   */
+  bool enabled = false;
+
+  /**\brief Whether to draw summary() over the bottom line of the screen
+   *
+   * May be toggled from any thread.
+   */
+  std::atomic<bool> overlay{false};
+
+  /**\brief Where to write dump() to when the interaction is destroyed */
+  std::ostream *dumpTo = nullptr;
+
+  /**\brief One-line summary
+   *
+   * \returns A short description of the current frame costs, suitable for
+   *          an on-screen overlay.
+   */
+  std::string summary(void) const {
+    std::ostringstream os("");
+    os << std::fixed << std::setprecision(0) << "frames " << flush.count
+       << " | refresh " << refresh.quantile(.5) << "us | post "
+       << postProcess.quantile(.5) << "us | flush " << flush.quantile(.5)
+       << "us p99 " << flush.quantile(.99) << "us | " << bytes.quantile(.5)
+       << "B | cmds " << commands.max() << " | anim "
+       << animators.max();
+    return os.str();
+  }
+
+  /**\brief Write out all statistics
+   *
+   * \param[out] os Where to write the statistics to.
+   */
+  void dump(std::ostream &os) const {
+    const std::pair<const char *, const rolling *> rs[] = {
+        {"refresh", &refresh},     {"post-process", &postProcess},
+        {"flush", &flush},         {"commands", &commands},
+        {"bytes", &bytes},         {"animators", &animators},
+        {"interval", &interval}};
+
+    for (const auto &r : rs) {
+      os << std::left << std::setw(13) << r.first << std::right
+         << " n=" << r.second->count << std::fixed << std::setprecision(1)
+         << " mean=" << r.second->mean() << " p50=" << r.second->quantile(.5)
+         << " p90=" << r.second->quantile(.9)
+         << " p99=" << r.second->quantile(.99) << " max=" << r.second->max()
+         << " hist=";
+
+      const auto h = r.second->histogram();
+      const auto last =
+          std::find_if(h.rbegin(), h.rend(),
+                       [](std::size_t n) -> bool { return n > 0; });
+      for (auto it = h.begin(); it != last.base(); it++) {
+        os << (it == h.begin() ? "" : ",") << *it;
+      }
+      os << "\n";
+    }
+  }
+};
+
+/**\brief Frame size of a terminal
+ *
+ * Terminals that know how many bytes their last flush wrote expose this as
+ * 'bytes'; for all others this reports zero.
+ */
+template <typename term, typename = void> class frameBytes {
+public:
+  static std::size_t get(const term &) { return 0; }
+};
+
+template <typename term>
+class frameBytes<term, std::void_t<decltype(std::declval<term>().bytes)>> {
+public:
+  static std::size_t get(const term &t) { return t.bytes; }
+};
+}
+}
+}
+
+#endif
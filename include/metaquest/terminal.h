@@ -15,46 +15,150 @@
 #if !defined(METAQUEST_TERMINAL_H)
 #define METAQUEST_TERMINAL_H
 
+#include <cassert>
 #include <iostream>
 
 #include <terminalxx/vt100.h>
 #include <terminalxx/terminal-writer.h>
+#include <metaquest/terminal-buffered.h>
+#include <metaquest/terminal-statistics.h>
+#include <metaquest/terminal-pacer.h>
+#include <metaquest/queue.h>
+#include <metaquest/logbook.h>
+#include <metaquest/combat-log.h>
 #include <metaquest/game.h>
 #include <metaquest/ai.h>
 #include <optional>
 #include <random>
 #include <sstream>
 #include <chrono>
-#include <list>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <functional>
 #include <utility>
 #include <algorithm>
+#include <limits>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <map>
+#include <initializer_list>
+#include <unordered_map>
+#include <type_traits>
 
 namespace metaquest {
 namespace interact {
 namespace terminal {
+/**\brief Rectangular screen region
+ *
+ * Describes a block of terminal cells, e.g. the area an animator may modify.
+ */
+class region {
+public:
+  std::size_t column;
+  std::size_t line;
+  std::size_t width;
+  std::size_t height;
+
+  bool contains(const std::size_t &l, const std::size_t &c) const {
+    return (l >= line) && (l - line < height) && (c >= column) &&
+           (c - column < width);
+  }
+
+  bool operator==(const region &b) const {
+    return (column == b.column) && (line == b.line) && (width == b.width) &&
+           (height == b.height);
+  }
+
+  bool operator!=(const region &b) const { return !(*this == b); }
+};
+
 namespace animator {
+template <typename term, typename clock> class base;
+
+/**\brief Animator storage
+ *
+ * Interface for whatever allocated an animator, so the animator can be handed
+ * back there once it's done.
+ */
+template <typename term, typename clock> class recycler {
+public:
+  virtual ~recycler(void) {}
+
+  virtual void recycle(base<term, clock> *animator) = 0;
+};
+
 template <typename term, typename clock> class base {
 public:
   base(const typename clock::duration &pSleepTime)
-      : sleepTime(pSleepTime), validSince(clock::now()), validUntil() {}
+      : sleepTime(pSleepTime), owner(nullptr), previous(nullptr),
+        next(nullptr), expired(false), validSince(clock::now()),
+        validUntil() {}
 
   base(const typename clock::duration &pSleepTime,
        const std::chrono::milliseconds &ttl)
-      : sleepTime(pSleepTime), validSince(clock::now()),
+      : sleepTime(pSleepTime), owner(nullptr), previous(nullptr),
+        next(nullptr), expired(false), validSince(clock::now()),
         validUntil(validSince + ttl) {}
 
   virtual ~base(void) {}
 
+  /**\brief Stop the animation
+   *
+   * May be called from any thread; the refresher picks this up on its next
+   * frame.
+   */
   bool expire(void) {
-    validUntil = clock::now();
+    expired = true;
     return true;
   }
 
   bool valid(void) {
-    return validUntil ? clock::now() < *validUntil : true;
+    return !expired && (validUntil ? clock::now() < *validUntil : true);
+  }
+
+  /**\brief Has the animation started yet?
+   *
+   * Animators may be scheduled to start in the future; until then they are
+   * not drawn.
+   *
+   * \returns 'true' once the animator's start time has passed.
+   */
+  bool started(void) const { return clock::now() >= validSince; }
+
+  /**\brief When the animator starts
+   *
+   * \returns The time at which the animation starts, or started.
+   */
+  const typename clock::time_point &since(void) const { return validSince; }
+
+  /**\brief Move the animation on a timeline
+   *
+   * Shifts the animation to start at the given time, and rescales its
+   * lifetime, if it has one. Needs to be called before the animator is
+   * handed to the refresher.
+   *
+   * \param[in] start The time at which the animation should start.
+   * \param[in] speed Speed multiplier; 2 plays the animation in half the
+   *                  time.
+   */
+  void schedule(const typename clock::time_point &start, double speed = 1.) {
+    if (validUntil) {
+      validUntil = start + std::chrono::duration_cast<typename clock::duration>(
+                               (*validUntil - validSince) / speed);
+    }
+    validSince = start;
+  }
+
+  /**\brief When the animator expires
+   *
+   * \returns The time at which the animator stops being valid, if it has a
+   *          limited lifetime.
+   */
+  const std::optional<typename clock::time_point> &until(void) const {
+    return validUntil;
   }
 
   double progress(typename clock::duration until) {
@@ -88,9 +192,51 @@ public:
                            const std::size_t &l, const std::size_t &c,
                            typename term::cell &cell) = 0;
 
+  /**\brief Area this animator touches
+   *
+   * Used by the refresher to figure out which cells an animator needs to be
+   * asked about. Animators that may modify any cell return nothing.
+   *
+   * \returns The region that postProcess() may modify, if it is limited.
+   */
+  virtual std::optional<region> bounds(void) const {
+    return std::optional<region>();
+  }
+
+  /**\brief Does the animator change over time?
+   *
+   * Animators whose output depends on their progress need their region
+   * redrawn on every frame; static ones only when they appear, move or
+   * disappear.
+   *
+   * \returns 'true' if postProcess() may give different results over time.
+   */
+  virtual bool animated(void) const { return false; }
+
   const typename clock::duration sleepTime;
 
+  /**\brief Region as of the last frame
+   *
+   * Maintained by the refresher, so it can tell when an animator has moved
+   * and which cells to restore once it's gone.
+   */
+  std::optional<region> drawn;
+
+  /**\brief Hand the animator back to its storage
+   *
+   * Destroys the animator; it must not be used after calling this.
+   */
+  void release(void) { owner->recycle(this); }
+
+  /**\brief Where the animator was allocated */
+  recycler<term, clock> *owner;
+
+  /**\brief Intrusive list links, maintained by animator::list */
+  base *previous;
+  base *next;
+
 protected:
+  std::atomic<bool> expired;
   typename clock::time_point validSince;
   std::optional<typename clock::time_point> validUntil;
 };
@@ -117,6 +263,10 @@ public:
     return false;
   }
 
+  virtual std::optional<region> bounds(void) const {
+    return region{column, line, width, height};
+  }
+
   std::size_t column;
   std::size_t line;
   std::size_t width;
@@ -165,6 +315,13 @@ public:
     return false;
   }
 
+  virtual std::optional<region> bounds(void) const {
+    return region{column, line, std::numeric_limits<std::size_t>::max(),
+                  height};
+  }
+
+  virtual bool animated(void) const { return true; }
+
   std::size_t column;
   std::size_t line;
   std::size_t width;
@@ -198,6 +355,12 @@ public:
     return false;
   }
 
+  virtual std::optional<region> bounds(void) const {
+    return region{column, line, width, height};
+  }
+
+  virtual bool animated(void) const { return true; }
+
   std::size_t column;
   std::size_t line;
   std::size_t width;
@@ -231,12 +394,151 @@ public:
     return false;
   }
 
+  virtual std::optional<region> bounds(void) const {
+    return region{0, line, std::numeric_limits<std::size_t>::max(), 1};
+  }
+
   std::size_t line;
   std::string message;
 };
+
+/**\brief Intrusive list of animators
+ *
+ * Links animators through their own 'previous' and 'next' pointers, so that
+ * adding and removing them is constant time and doesn't allocate. The list
+ * does not own its elements.
+ */
+template <typename term, typename clock> class list {
+public:
+  using animator = base<term, clock>;
+
+  class iterator {
+  public:
+    iterator(animator *pCurrent) : current(pCurrent) {}
+
+    animator *operator*(void) const { return current; }
+
+    iterator &operator++(void) {
+      current = current->next;
+      return *this;
+    }
+
+    bool operator!=(const iterator &b) const { return current != b.current; }
+
+  protected:
+    animator *current;
+  };
+
+  list(void) : head(nullptr), tail(nullptr) {}
+
+  iterator begin(void) const { return iterator(head); }
+  iterator end(void) const { return iterator(nullptr); }
+
+  bool empty(void) const { return head == nullptr; }
+
+  void push_back(animator *a) {
+    a->previous = tail;
+    a->next = nullptr;
+
+    if (tail) {
+      tail->next = a;
+    } else {
+      head = a;
+    }
+
+    tail = a;
+  }
+
+  /**\brief Unlink an animator
+   *
+   * \param[in] a The animator to remove; must be in this list.
+   *
+   * \returns The animator that followed the removed one.
+   */
+  animator *erase(animator *a) {
+    animator *n = a->next;
+
+    (a->previous ? a->previous->next : head) = a->next;
+    (a->next ? a->next->previous : tail) = a->previous;
+
+    a->previous = nullptr;
+    a->next = nullptr;
+
+    return n;
+  }
+
+protected:
+  animator *head;
+  animator *tail;
+};
+
+/**\brief Typed animator pool
+ *
+ * Allocates animators of a single type in blocks and keeps the slots of
+ * recycled ones around for reuse, so busy animations don't keep hitting the
+ * heap. The pool must outlive all the animators it handed out.
+ *
+ * Neither side takes a lock: acquire() works off a free list private to the
+ * allocating thread, and recycle() pushes slots onto a lock-free stack that
+ * acquire() takes over in one go whenever its own list runs dry. acquire()
+ * must therefore only be used by one thread at a time, while recycle() may be
+ * called from anywhere.
+ *
+ * \tparam A The animator type to allocate.
+ */
+template <typename term, typename clock, typename A>
+class pool : public recycler<term, clock> {
+public:
+  pool(std::size_t pBlockSize = 16)
+      : blockSize(pBlockSize), returned(nullptr) {}
+
+  template <typename... Args> A &acquire(Args &&... args) {
+    if (available.empty()) {
+      for (void *p = returned.exchange(nullptr); p != nullptr;) {
+        available.push_back(p);
+        p = *static_cast<void **>(p);
+      }
+    }
+
+    if (available.empty()) {
+      grow();
+    }
+
+    void *slot = available.back();
+    available.pop_back();
+
+    A *a = new (slot) A(std::forward<Args>(args)...);
+    a->owner = this;
+    return *a;
+  }
+
+  virtual void recycle(base<term, clock> *animator) {
+    A *a = static_cast<A *>(animator);
+    a->~A();
+
+    void **link = new (static_cast<void *>(a)) void *(returned.load());
+    while (!returned.compare_exchange_weak(*link, a))
+      ;
+  }
+
+protected:
+  using storage = typename std::aligned_storage<sizeof(A), alignof(A)>::type;
+
+  void grow(void) {
+    blocks.emplace_back(new storage[blockSize]);
+    for (std::size_t i = 0; i < blockSize; i++) {
+      available.push_back(&blocks.back()[i]);
+    }
+  }
+
+  const std::size_t blockSize;
+  std::vector<std::unique_ptr<storage[]>> blocks;
+  std::vector<void *> available;
+  std::atomic<void *> returned;
+};
 }
 
-template <typename term = terminalxx::vt100<>,
+template <typename term = buffered<>,
           template <typename> class AI = ai::random,
           typename clock = std::chrono::system_clock>
 class base;
@@ -244,48 +546,234 @@ class base;
 template <typename term, template <typename> class AI, typename clock>
 class refresher {
 public:
-  refresher(base<term, AI> &pBase) : base(pBase) {}
+  refresher(base<term, AI> &pBase)
+      : base(pBase), refreshTime(), postProcessTime(), commands(0),
+        measuring(false), overlaid(false) {}
+
+  /**\brief Take over newly added animators
+   *
+   * Moves everything that was registered with base::addAnimator() since the
+   * last frame into the refresher's own list of active animators, in the
+   * order they were added.
+   */
+  void adopt(void) {
+    animator::base<term, clock> *added = base.incoming.exchange(nullptr);
+    animator::base<term, clock> *ordered = nullptr;
+
+    while (added != nullptr) {
+      auto *n = added->next;
+      added->next = ordered;
+      ordered = added;
+      added = n;
+    }
+
+    while (ordered != nullptr) {
+      auto *n = ordered->next;
+      base.active.push_back(ordered);
+      ordered = n;
+    }
+  }
+
+  /**\brief Run queued render commands
+   *
+   * Applies everything the game thread queued with base::render(), in order.
+   */
+  void apply(void) {
+    std::function<void(void)> command;
+
+    while (base.commands.pop(command)) {
+      command();
+      commands++;
+    }
+  }
 
   bool refresh() {
-    std::lock_guard<std::mutex> lock(base.activeMutex);
-
-    for (auto it = base.active.begin(); it != base.active.end();) {
-      if (!(*it)->valid()) {
-        auto *p = *it;
-        base.active.erase(it);
-        delete p;
-        it = base.active.begin();
-      } else {
-        it++;
+    const auto start = measuring ? std::chrono::steady_clock::now()
+                                 : std::chrono::steady_clock::time_point();
+
+    adopt();
+    apply();
+
+    for (auto *a = *base.active.begin(); a != nullptr;) {
+      if (a->valid()) {
+        a = a->next;
+        continue;
       }
+
+      if (a->drawn) {
+        damage(*a->drawn);
+      }
+
+      auto *n = base.active.erase(a);
+      a->release();
+      a = n;
     }
 
     bool ret = false;
 
     for (const auto &a : base.active) {
-      if (a->valid()) {
+      if (a->valid() && a->started()) {
         ret = a->draw(base.io) || ret;
       }
     }
 
+    if (measuring) {
+      refreshTime += std::chrono::steady_clock::now() - start;
+    }
+
     return ret;
   }
 
   typename term::cell postProcess(const typename term::base &terminal,
                                   const std::size_t &l, const std::size_t &c) {
+    if ((l >= dirty.size()) || !dirty[l]) {
+      return terminal.current[l][c];
+    }
+
+    if (measuring && (c == 0)) {
+      rowStart = std::chrono::steady_clock::now();
+    }
+
     typename term::cell cell = terminal.target[l][c];
 
-    for (const auto &a : base.active) {
-      if (a->valid()) {
-        (void)a->postProcess(terminal, l, c, cell);
+    if (l < rows.size()) {
+      for (const auto &s : rows[l]) {
+        if ((c >= s.column) && (c - s.column < s.width)) {
+          (void)s.animator->postProcess(terminal, l, c, cell);
+        }
       }
     }
 
+    if (overlaid && (l + 1 == dirty.size())) {
+      std::swap(cell.foregroundColour, cell.backgroundColour);
+      cell.content = c < overlay.size() ? overlay[c] : ' ';
+    }
+
+    if (measuring && (c + 1 == terminal.target[l].size())) {
+      postProcessTime += std::chrono::steady_clock::now() - rowStart;
+    }
+
     return cell;
   }
 
+  /**\brief Build the per-row animator index
+   *
+   * Sorts the currently valid animators into the screen rows they cover, so
+   * that postProcess() only needs to consult the animators that can actually
+   * modify a given cell. Animators keep their relative order within a row.
+   * Refresher thread only.
+   *
+   * \returns The number of animators in the index.
+   */
+  std::size_t index(void) {
+    std::size_t n = 0;
+
+    rows.resize(base.io.size()[1]);
+    for (auto &r : rows) {
+      r.clear();
+    }
+
+    for (const auto &a : base.active) {
+      if (!a->valid() || !a->started()) {
+        continue;
+      }
+
+      const auto b = a->bounds();
+      const region r =
+          b ? *b : region{0, 0, std::numeric_limits<std::size_t>::max(),
+                          std::numeric_limits<std::size_t>::max()};
+
+      for (std::size_t l = r.line; (l < rows.size()) && (l - r.line < r.height);
+           l++) {
+        rows[l].push_back({a, r.column, r.width});
+      }
+
+      n++;
+    }
+
+    return n;
+  }
+
+  /**\brief Mark rows for redrawing
+   *
+   * \param[in] r The region that needs to be redrawn.
+   */
+  void damage(const region &r) {
+    for (std::size_t l = r.line; (l < dirty.size()) && (l - r.line < r.height);
+         l++) {
+      dirty[l] = true;
+    }
+  }
+
+  /**\brief Gather this frame's dirty rows
+   *
+   * Combines the rows that were written to since the last frame with the
+   * regions of animators that appeared, moved or are in motion, and the
+   * bottom row when the statistics overlay was switched on or off. Refresher
+   * thread only.
+   *
+   * \returns 'true' if anything needs to be redrawn.
+   */
+  bool collect(void) {
+    dirty.resize(base.io.size()[1], false);
+
+    base.damaged.resize(dirty.size(), false);
+    for (std::size_t l = 0; l < dirty.size(); l++) {
+      if (base.damaged[l]) {
+        dirty[l] = true;
+        base.damaged[l] = false;
+      }
+    }
+
+    for (const auto &a : base.active) {
+      if (!a->valid() || !a->started()) {
+        continue;
+      }
+
+      const auto b = a->bounds();
+      const region r =
+          b ? *b : region{0, 0, std::numeric_limits<std::size_t>::max(),
+                          std::numeric_limits<std::size_t>::max()};
+
+      if (!a->drawn || (*a->drawn != r) || a->animated()) {
+        if (a->drawn) {
+          damage(*a->drawn);
+        }
+        damage(r);
+        a->drawn = r;
+      }
+    }
+
+    const bool o = base.statistics.overlay.load(std::memory_order_relaxed);
+    if ((o != overlaid) && !dirty.empty()) {
+      overlaid = o;
+      overlay.clear();
+      dirty.back() = true;
+    }
+
+    return std::find(dirty.begin(), dirty.end(), true) != dirty.end();
+  }
+
   void flush(void) {
-    std::lock_guard<std::mutex> lock(base.activeMutex);
+    if (!collect()) {
+      return;
+    }
+
+    auto &stats = base.statistics;
+
+    if (overlaid) {
+      const auto summary = stats.summary();
+      if (summary != overlay) {
+        overlay = summary;
+        dirty.back() = true;
+      }
+    }
+
+    const auto animators = index();
+
+    postProcessTime = std::chrono::steady_clock::duration::zero();
+
+    const auto start = std::chrono::steady_clock::now();
 
     while (base.io.flush([this](const typename term::base &terminal,
                                 const std::size_t &l,
@@ -293,22 +781,67 @@ public:
       return postProcess(terminal, l, c);
     }))
       ;
-  }
 
-  typename clock::duration sleepTime(void) {
-    std::lock_guard<std::mutex> lock(base.activeMutex);
+    dirty.assign(dirty.size(), false);
+
+    const auto flushTime =
+        std::chrono::steady_clock::now() - start - postProcessTime;
+
+    if (measuring) {
+      stats.refresh.add(microseconds(refreshTime));
+      stats.postProcess.add(microseconds(postProcessTime));
+    }
+    stats.flush.add(microseconds(flushTime));
+    stats.commands.add(commands);
+    stats.bytes.add(frameBytes<term>::get(base.io));
+    stats.animators.add(animators);
+
+    pace.add(flushTime, frameBytes<term>::get(base.io),
+             frameBacklog<term>::get(base.io));
+    stats.interval.add(microseconds(pace.interval()));
+    lastFrame = clock::now();
+
+    refreshTime = std::chrono::steady_clock::duration::zero();
+    commands = 0;
+    measuring = stats.enabled || overlaid;
+  }
 
-    typename clock::duration sleepFor = std::chrono::milliseconds(50);
+  /**\brief When the next frame is due
+   *
+   * Animators in motion want a new frame after their sleep time, scheduled
+   * animators need one when they start, and any animator with a limited
+   * lifetime needs one when it expires so its cells can be restored.
+   * Everything else is driven by base::notify(). Animation ticks are never
+   * scheduled sooner than the pacer's interval after the previous frame.
+   *
+   * \returns The time of the next frame, if one is due at all.
+   */
+  std::optional<typename clock::time_point> deadline(void) {
+    const auto now = clock::now();
+    std::optional<typename clock::time_point> next;
 
     for (const auto &a : base.active) {
-      if (a->valid()) {
-        if (a->sleepTime < sleepFor) {
-          sleepFor = a->sleepTime;
+      if (!a->valid()) {
+        return now;
+      }
+
+      std::optional<typename clock::time_point> t = a->until();
+      if (!a->started()) {
+        t = a->since();
+      } else if (a->animated()) {
+        const auto tick = std::max<typename clock::time_point>(
+            now + a->sleepTime, lastFrame + pace.interval());
+        if (!t || (tick < *t)) {
+          t = tick;
         }
       }
+
+      if (t && (!next || (*t < *next))) {
+        next = t;
+      }
     }
 
-    return sleepFor;
+    return next;
   }
 
   static void run(base<term, AI, clock> &pBase) {
@@ -317,14 +850,85 @@ public:
     while (self.base.alive) {
       self.refresh();
       self.flush();
-      std::this_thread::sleep_for(self.sleepTime());
+
+      const auto next = self.deadline();
+
+      std::unique_lock<std::mutex> lock(self.base.wakeMutex);
+      const auto woken = [&self]() -> bool {
+        return self.base.pending || !self.base.alive;
+      };
+
+      if (next) {
+        self.base.wakeup.wait_until(lock, *next, woken);
+      } else {
+        self.base.wakeup.wait(lock, woken);
+      }
+
+      self.base.pending = false;
+
+      // coalesce whatever else comes in until the terminal is ready
+      lock.unlock();
+      const auto ready = self.lastFrame + self.pace.interval();
+      if (self.base.alive && (clock::now() < ready)) {
+        std::this_thread::sleep_until(ready);
+      }
     }
 
+    self.refresh();
     self.flush();
   }
 
 protected:
   base<term, AI, clock> &base;
+
+  /**\brief Animator covering part of a row
+   *
+   * An entry in the per-row animator index, along with the columns it spans.
+   */
+  class span {
+  public:
+    animator::base<term, clock> *animator;
+    std::size_t column;
+    std::size_t width;
+  };
+
+  std::vector<std::vector<span>> rows;
+
+  /**\brief Frame pacing */
+  pacer pace;
+
+  /**\brief When the last frame was written */
+  typename clock::time_point lastFrame;
+
+  /**\brief Rows that need to be redrawn in the current frame */
+  std::vector<bool> dirty;
+
+  /**\brief Time spent on the frame that is being drawn
+   *
+   * Accumulated across the refresh() and flush() calls that make up a frame,
+   * and handed to the statistics once the frame is out.
+   */
+  std::chrono::steady_clock::duration refreshTime;
+  std::chrono::steady_clock::duration postProcessTime;
+  std::size_t commands;
+
+  /**\brief Whether refresh and post-processing times are being measured
+   *
+   * Post-processing is timed per row, from a row's first cell to its last,
+   * rather than per cell.
+   */
+  bool measuring;
+  std::chrono::steady_clock::time_point rowStart;
+
+  /**\brief Statistics overlay text, as currently on screen */
+  std::string overlay;
+
+  /**\brief Whether the overlay is drawn in the current frame */
+  bool overlaid;
+
+  static double microseconds(const std::chrono::steady_clock::duration &d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  }
 };
 
 template <typename term, template <typename> class AI, typename clock>
@@ -337,38 +941,285 @@ public:
   using flash = animator::flash<term, clock>;
 
   base()
-      : io(), out(io), ai(*this), alive(true),
-        refresherThread(refresher<term, AI, clock>::run, std::ref(*this)) {
-    logbook.toArray();
-    io.resize(io.getOSDimensions());
+      : io(), out(io), screen(io.getOSDimensions()), ai(*this), alive(true),
+        incoming(nullptr), pending(false), speed(1.),
+        maxLag(std::chrono::seconds(5)), timeline(clock::now()) {
+    const std::size_t rows =
+        screen[1] > queryRows ? screen[1] - queryRows : 0;
+    enemies = {0, rows - rows / 2, 0};
+    queryTop = enemies.rows;
+    players = {queryTop + queryRows, rows / 2, 0};
+
+    io.resize(screen);
     clear();
+    refresherThread =
+        std::thread(refresher<term, AI, clock>::run, std::ref(*this));
   }
 
   ~base(void) {
     clear();
-    alive = false;
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      alive = false;
+    }
+    wakeup.notify_one();
     refresherThread.join();
-    for (auto &a : active) {
-      delete a;
+    while (!active.empty()) {
+      auto *a = *active.begin();
+      active.erase(a);
+      a->release();
+    }
+
+    for (auto *a = incoming.exchange(nullptr); a != nullptr;) {
+      auto *n = a->next;
+      a->release();
+      a = n;
+    }
+
+    if (statistics.dumpTo) {
+      statistics.dump(*statistics.dumpTo);
     }
   }
 
+  /**\brief Terminal state
+   *
+   * Both of these belong to the refresher thread once it's running; the game
+   * thread only reads input from 'io' and has everything else done by
+   * render().
+   */
   term io;
   terminalxx::writer<> out;
+
+  /**\brief Terminal dimensions, as of when the interaction was created */
+  const std::array<std::size_t, 2> screen;
+
+  /**\brief Render statistics
+   *
+   * Maintained by the refresher thread; see terminal::statistics for when
+   * it's safe to read these.
+   */
+  terminal::statistics statistics;
   AI<base<term, AI>> ai;
-  efgy::json::json logbook;
+  metaquest::logbook logbook;
+
+  /**\brief Combat statistics
+   *
+   * One row per action that was carried out, with the HP change it caused;
+   * filled in by record().
+   */
+  columnar::store combat;
   std::thread refresherThread;
   volatile bool alive;
-  std::list<animator::base<term, clock> *> active;
-  std::mutex activeMutex;
+  /**\brief Active animators
+   *
+   * Owned by the refresher thread, which is the only one to walk or modify
+   * this list; other threads hand new animators over through 'incoming'.
+   */
+  animator::list<term, clock> active;
+
+  /**\brief Newly added animators
+   *
+   * A lock-free stack, linked through the animators' 'next' pointers, that
+   * the refresher takes over at the start of every frame.
+   */
+  std::atomic<animator::base<term, clock> *> incoming;
+
+  std::tuple<animator::pool<term, clock, selector>,
+             animator::pool<term, clock, highlight>,
+             animator::pool<term, clock, glow>,
+             animator::pool<term, clock, text>,
+             animator::pool<term, clock, flash>> pools;
+
+  /**\brief Rows written to since the last frame
+   *
+   * Refresher thread only, as is everything else written through 'out'.
+   */
+  std::vector<bool> damaged;
+
+  /**\brief Queued render commands
+   *
+   * Filled by the game thread with render(); the refresher thread runs the
+   * commands at the start of its next frame.
+   */
+  queue<std::function<void(void)>> commands;
+
+  /**\brief Queue a render command
+   *
+   * Hands a piece of drawing code to the refresher thread, which runs it
+   * before drawing its next frame. Commands run in the order they were
+   * queued, and are the only place where 'out' may be written to. Blocks if
+   * the refresher has fallen too far behind.
+   *
+   * \param[in] command What to draw; must capture everything it uses that
+   *                    the game thread might change in the meantime.
+   */
+  void render(std::function<void(void)> command) {
+    while (!commands.push(std::move(command))) {
+      notify();
+      std::this_thread::yield();
+    }
+    notify();
+  }
+
+  /**\brief Refresher wakeup
+   *
+   * The refresher thread sleeps on this until there's something new to draw
+   * or an animation needs its next frame. 'pending' is set whenever it has
+   * been notified, so a notification that arrives while a frame is being
+   * drawn isn't lost.
+   */
+  std::condition_variable wakeup;
+  std::mutex wakeMutex;
+  bool pending;
+
+  /**\brief Wake the refresher thread
+   *
+   * Called whenever something on screen changes, including animators that
+   * are moved or expired from the game thread.
+   */
+  void notify(void) {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      pending = true;
+    }
+    wakeup.notify_one();
+  }
 
+  /**\brief Show or hide the statistics overlay
+   *
+   * Safe to call from any thread; the bottom row is redrawn with the next
+   * frame either way.
+   *
+   * \param[in] on Whether to show the overlay.
+   */
+  void showStatistics(bool on) {
+    statistics.overlay = on;
+    notify();
+  }
+
+  /**\brief Stop an animation
+   *
+   * The animator is only touched later, on the refresher thread, so it must
+   * not have a time to live: the refresher hands animators back to their pool
+   * as soon as they expire, and one with a TTL may already be gone by then.
+   *
+   * \param[in] anim The animator to expire; it must not be used afterwards.
+   */
+  void expire(animator::base<term, clock> &anim) {
+    assert(!anim.until());
+    render([&anim]() { anim.expire(); });
+  }
+
+  /**\brief Move a highlight to another line
+   *
+   * Like expire(), only for animators without a time to live, and not after
+   * expire() was called for it. Does nothing if the animator has expired by
+   * the time the refresher gets to it.
+   *
+   * \param[in] anim The animator to move.
+   * \param[in] line The line to move it to.
+   */
+  void move(highlight &anim, std::size_t line) {
+    assert(!anim.until());
+    render([&anim, line]() {
+      if (anim.valid()) {
+        anim.line = line;
+      }
+    });
+  }
+
+  /**\brief Add an animator to the active list
+   *
+   * \param[in] anim An animator that was allocated from an animator::pool,
+   *                 e.g. with animate().
+   */
   void addAnimator(animator::base<term, clock> *anim) {
-    std::lock_guard<std::mutex> lock(activeMutex);
+    anim->next = incoming.load();
+    while (!incoming.compare_exchange_weak(anim->next, anim))
+      ;
+    notify();
+  }
 
-    active.push_back(anim);
+  /**\brief Start a new animation
+   *
+   * Allocates an animator from the matching pool and adds it to the list of
+   * active animators. The refresher hands it back to the pool once it has
+   * expired.
+   *
+   * \tparam A    The animator type, e.g. 'flash'.
+   * \tparam Args Constructor argument types for the animator.
+   *
+   * \returns The new animator; only valid until it has expired.
+   */
+  template <typename A, typename... Args> A &animate(Args &&... args) {
+    A &a = std::get<animator::pool<term, clock, A>>(pools).acquire(
+        std::forward<Args>(args)...);
+    addAnimator(&a);
+    return a;
   }
 
-  void clear(void) { out.to(0, 0).clear(); }
+  /**\brief Start a new animation at a later time
+   *
+   * Like animate(), but the animation starts at the given time and plays at
+   * the current animation speed.
+   *
+   * \param[in] start When the animation should start.
+   */
+  template <typename A, typename... Args>
+  A &animateAt(const typename clock::time_point &start, Args &&... args) {
+    A &a = std::get<animator::pool<term, clock, A>>(pools).acquire(
+        std::forward<Args>(args)...);
+    a.schedule(start, speed);
+    addAnimator(&a);
+    return a;
+  }
+
+  /**\brief Animation speed
+   *
+   * Multiplier for the duration of combat animations; 2 plays them twice as
+   * fast. Zero, or anything below, skips them altogether.
+   */
+  double speed;
+
+  /**\brief Maximum animation backlog
+   *
+   * Combat animations are queued on a timeline, so the game doesn't need to
+   * wait for them. If the timeline runs further ahead than this, the game
+   * thread is held back until it has caught up.
+   */
+  typename clock::duration maxLag;
+
+  /**\brief Wait for queued animations
+   *
+   * Blocks until every animation on the timeline has played, e.g. before
+   * asking the player for input.
+   */
+  void sync(void) { std::this_thread::sleep_until(timeline); }
+
+  /**\brief Mark rows as changed
+   *
+   * Needs to be called for anything written through 'out', so that the
+   * refresher knows which rows to redraw in the next frame. Like 'out', this
+   * is only to be used from render commands.
+   *
+   * \param[in] line   The first row that was written to.
+   * \param[in] height The number of rows that were written to.
+   */
+  void damage(std::size_t line, std::size_t height = 1) {
+    damaged.resize(screen[1], false);
+    for (std::size_t l = line; (l < damaged.size()) && (l - line < height);
+         l++) {
+      damaged[l] = true;
+    }
+  }
+
+  void clear(void) {
+    invalidate(0, shown.size());
+    render([this]() {
+      out.to(0, 0).clear();
+      damage(0, screen[1]);
+    });
+  }
 
   template <typename G>
   bool
@@ -391,14 +1242,266 @@ public:
     return true;
   }
 
-  void log(std::string log) { logbook.push(log); }
+  void log(std::string log) { logbook.push(efgy::json::json(log)); }
+
+  template <typename G>
+  void
+  record(const G &game, const std::string &description,
+         const metaquest::character<typename G::num> &source,
+         const std::vector<metaquest::character<typename G::num> *> &targets,
+         const std::vector<typename G::num> &amounts, std::size_t turn) {
+    const auto slot = [&game](const metaquest::character<typename G::num> &c) {
+      return std::to_string(game.partyOf(c)) + "/" +
+             std::to_string(game.positionOf(c));
+    };
+
+    std::vector<std::pair<std::string, std::int64_t>> ts;
+
+    for (std::size_t i = 0; i < targets.size(); i++) {
+      ts.push_back({slot(*targets[i]), std::int64_t(amounts[i])});
+    }
+
+    combat.push(turn, slot(source), game.partyOf(source), source.archetype(),
+                description, ts);
+  }
+
+  /**\brief Scroll window over the combatant list
+   *
+   * A range of screen rows that shows a part of the combatant list. If there
+   * are more combatants than rows, the last rows summarise who is scrolled out
+   * of view, one row per party.
+   */
+  class window {
+  public:
+    /**\brief The first screen row */
+    std::size_t top;
+
+    /**\brief The number of screen rows */
+    std::size_t rows;
+
+    /**\brief The first combatant shown, if the list is scrolled */
+    std::size_t offset;
+  };
+
+  /**\brief Player party window, below the query area */
+  window players;
+
+  /**\brief Window for all other parties, above the query area */
+  window enemies;
+
+  /**\brief The first screen row of the query area */
+  std::size_t queryTop;
+
+  /**\brief The number of screen rows of the query area
+   *
+   * The rest of the screen is split between the two windows, with the extra
+   * row going to the enemies if there's an odd number of rows left.
+   */
+  static constexpr std::size_t queryRows = 10;
+
+  /**\brief Combatants, by window
+   *
+   * \param[in] game The game whose combatants to list.
+   *
+   * \returns The player party, followed by all other parties with an empty
+   *          entry between each of them.
+   */
+  template <typename G>
+  std::array<std::vector<const metaquest::character<typename G::num> *>, 2>
+  combatants(const G &game) const {
+    std::array<std::vector<const metaquest::character<typename G::num> *>, 2>
+        rv;
+
+    for (std::size_t pa = 0; pa < game.parties.size(); pa++) {
+      auto &list = rv[pa == 0 ? 0 : 1];
+      if (pa > 1) {
+        list.push_back(nullptr);
+      }
+      for (const auto &c : game.parties[pa]) {
+        list.push_back(&c);
+      }
+    }
+
+    return rv;
+  }
+
+  /**\brief Rows for combatants in a scrolled window
+   *
+   * Each party with combatants out of view needs a summary row at the bottom
+   * of the window; the rows above those show combatants.
+   *
+   * \param[in]     list   The combatants in the window, as from combatants().
+   * \param[in]     rows   The number of rows in the window.
+   * \param[in,out] offset The first combatant to show; moved back if that
+   *                       would leave rows empty.
+   *
+   * \returns The number of rows that show combatants.
+   */
+  template <typename C>
+  static std::size_t span(const std::vector<const C *> &list, std::size_t rows,
+                          std::size_t &offset) {
+    const std::size_t wanted = offset;
+
+    for (std::size_t summaries = 1;;) {
+      const std::size_t s = rows - summaries;
+      offset = std::min(wanted, list.size() - s);
+
+      std::size_t hidden = 0;
+      bool out = false;
+      for (std::size_t k = 0; k <= list.size(); k++) {
+        if ((k == list.size()) || !list[k]) {
+          hidden += out ? 1 : 0;
+          out = false;
+        } else if ((k < offset) || (k >= offset + s)) {
+          out = true;
+        }
+      }
+
+      if ((hidden <= summaries) || (summaries + 1 >= rows)) {
+        return s;
+      }
+      summaries = std::min(hidden, rows - 1);
+    }
+  }
+
+  /**\brief Lay out the combatant list
+   *
+   * Works out which combatants are visible and where.
+   *
+   * \param[in] game    The game whose combatants to lay out.
+   * \param[in] visible Called with each visible combatant and its line.
+   * \param[in] summary Called with each summary line of a scrolled window
+   *                    and the combatants of one party that are out of
+   *                    view; with none for lines of a scrolled window that
+   *                    show nobody.
+   */
+  template <typename G, typename V, typename S>
+  void arrange(const G &game, V visible, S summary) {
+    const auto lists = combatants(game);
+
+    for (std::size_t w = 0; w < lists.size(); w++) {
+      auto &win = w == 0 ? players : enemies;
+      const auto &list = lists[w];
+
+      if (win.rows == 0) {
+        // no room at all, so everyone is on a line below the screen.
+        std::vector<const metaquest::character<typename G::num> *> hidden;
+        std::copy_if(list.begin(), list.end(), std::back_inserter(hidden),
+                     [](const metaquest::character<typename G::num> *c) {
+                       return c != nullptr;
+                     });
+        summary(screen[1], hidden);
+        continue;
+      }
+
+      if (list.size() <= win.rows) {
+        const std::size_t first =
+            win.top + (w == 0 ? win.rows - list.size() : 0);
+        for (std::size_t k = 0; k < list.size(); k++) {
+          if (list[k]) {
+            visible(*list[k], first + k);
+          }
+        }
+        continue;
+      }
+
+      const std::size_t s = span(list, win.rows, win.offset);
+      std::vector<std::vector<const metaquest::character<typename G::num> *>>
+          hidden(win.rows - s);
+      std::size_t h = 0;
+
+      for (std::size_t k = 0; k < list.size(); k++) {
+        const bool shown = (k >= win.offset) && (k < win.offset + s);
+        if (!list[k]) {
+          if (shown) {
+            summary(win.top + k - win.offset, {});
+          }
+          if (!hidden[h].empty() && (h + 1 < hidden.size())) {
+            h++;
+          }
+        } else if (shown) {
+          visible(*list[k], win.top + k - win.offset);
+        } else {
+          hidden[h].push_back(list[k]);
+        }
+      }
+
+      for (std::size_t l = 0; l < hidden.size(); l++) {
+        summary(win.top + s + l, hidden[l]);
+      }
+    }
+  }
+
+  /**\brief Scroll a character into view
+   *
+   * \param[in] game      The game the character is in.
+   * \param[in] character The character to show.
+   *
+   * \returns 'true' if the window had to be scrolled.
+   */
+  template <typename T, typename G>
+  bool reveal(const G &game, const metaquest::character<T> &character) {
+    const auto lists = combatants(game);
+
+    for (std::size_t w = 0; w < lists.size(); w++) {
+      auto &win = w == 0 ? players : enemies;
+      const auto &list = lists[w];
+      const auto it = std::find(list.begin(), list.end(), &character);
+
+      if ((it == list.end()) || (list.size() <= win.rows) || (win.rows == 0)) {
+        continue;
+      }
+
+      const std::size_t k = it - list.begin(), previous = win.offset;
+
+      for (std::size_t i = 0; i < list.size(); i++) {
+        std::size_t offset = win.offset;
+        const std::size_t s = span(list, win.rows, offset);
+        offset = k < offset ? k : k >= offset + s ? k - s + 1 : offset;
+        if (offset == win.offset) {
+          break;
+        }
+        win.offset = offset;
+      }
+
+      if (win.offset != previous) {
+        return true;
+      }
+    }
+
+    return false;
+  }
 
   template <typename T, typename G>
   std::size_t getLine(const G &game, const metaquest::character<T> &character) {
-    const auto &pa = game.partyOf(character);
-    const auto &pp = game.positionOf(character);
+    return getLines(game).at(&character);
+  }
 
-    return pp + (pa == 0 ? io.size()[1] - game.parties[pa].size() : 0);
+  /**\brief Lines of all characters
+   *
+   * Same as calling getLine() for every character, but only goes through the
+   * parties once. Characters that are scrolled out of view are on the
+   * summary line of their window.
+   *
+   * \param[in] game The game whose characters to look up.
+   *
+   * \returns The line each character is displayed on.
+   */
+  template <typename G>
+  std::unordered_map<const metaquest::character<typename G::num> *,
+                     std::size_t>
+  getLines(const G &game) {
+    using character = metaquest::character<typename G::num>;
+    std::unordered_map<const character *, std::size_t> rv;
+
+    arrange(game, [&rv](const character &c, std::size_t l) { rv[&c] = l; },
+            [&rv](std::size_t l, const std::vector<const character *> &cs) {
+              for (const auto &c : cs) {
+                rv[c] = l;
+              }
+            });
+
+    return rv;
   }
 
   template <typename G>
@@ -406,59 +1509,223 @@ public:
   action(const G &game, const std::string &description,
          const metaquest::character<typename G::num> &source,
          const std::vector<metaquest::character<typename G::num> *> &targets) {
-    addAnimator(new flash(0, getLine(game, source), io.size()[0], 1));
-    addAnimator(new text(8, source.name.display() + ": " + description));
+    if (speed <= 0) {
+      return log(game, description, source, targets);
+    }
+
+    const auto now = clock::now();
+    if (timeline < now) {
+      timeline = now;
+    } else if (timeline - now > maxLag) {
+      std::this_thread::sleep_until(timeline - maxLag);
+    }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    const auto start = timeline;
+    const auto lines = getLines(game);
+
+    animateAt<flash>(start, 0, lines.at(&source), screen[0], 1);
+    animateAt<text>(start, queryTop,
+                    source.name.display() + ": " + description);
 
     for (auto &t : targets) {
-      addAnimator(new glow(0, getLine(game, *t), io.size()[0], 1));
+      animateAt<glow>(start + scale(std::chrono::milliseconds(500)), 0,
+                      lines.at(t), screen[0], 1);
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    timeline = start + scale(std::chrono::milliseconds(1500));
 
     return log(game, description, source, targets);
   }
 
+  /**\brief Combatant row
+   *
+   * Everything drawUI() displays for a single character.
+   */
+  class row {
+  public:
+    long line;
+    std::string name;
+    long hp;
+    long hpTotal;
+    long mp;
+    long mpTotal;
+
+    bool operator==(const row &b) const {
+      return line == b.line && hp == b.hp && mp == b.mp &&
+             hpTotal == b.hpTotal && mpTotal == b.mpTotal && name == b.name;
+    }
+  };
+
+  /**\brief Combatant rows currently on screen
+   *
+   * What drawUI() last drew on each line, so it can skip rows that haven't
+   * changed. Game thread only.
+   */
+  std::vector<std::optional<row>> shown;
+
+  /**\brief Forget about drawn combatant rows
+   *
+   * To be called whenever something is drawn over combatant rows, so that
+   * the next drawUI() draws them again.
+   *
+   * \param[in] line   The first row that is drawn over.
+   * \param[in] height The number of rows that are drawn over.
+   */
+  void invalidate(std::size_t line, std::size_t height = 1) {
+    for (std::size_t l = line; (l < shown.size()) && (l - line < height);
+         l++) {
+      shown[l].reset();
+    }
+  }
+
   template <typename G> void drawUI(G &game) {
-    long in = 0, i = 0;
+    using character = metaquest::character<typename G::num>;
+    std::vector<row> rows;
+
+    shown.resize(screen[1]);
 
     clearQuery();
 
-    for (auto &party : game.parties) {
-      if (in == 0) {
-        i = -party.size();
-      } else if (in == 1) {
-        i = 0;
-      } else {
-        i++;
+    const auto update = [this, &rows](row &&r) {
+      const std::size_t l = r.line;
+      if (l < shown.size() && !(shown[l] && *shown[l] == r)) {
+        shown[l] = r;
+        rows.push_back(std::move(r));
       }
-      in++;
+    };
+
+    arrange(game,
+            [&update](const character &p, std::size_t l) {
+              update({long(l), p.name.full(), long(p["HP/Current"]),
+                      long(p["HP/Total"]), long(p["MP/Current"]),
+                      long(p["MP/Total"])});
+            },
+            [&update](std::size_t l, const std::vector<const character *> &cs) {
+              row r{long(l),
+                    cs.empty() ? "" : "+" + std::to_string(cs.size()) + " more",
+                    0, 0, 0, 0};
+              for (const auto &p : cs) {
+                r.hp += long((*p)["HP/Current"]);
+                r.hpTotal += long((*p)["HP/Total"]);
+                r.mp += long((*p)["MP/Current"]);
+                r.mpTotal += long((*p)["MP/Total"]);
+              }
+              update(std::move(r));
+            });
+
+    if (rows.empty()) {
+      return;
+    }
 
-      for (auto &p : party) {
-        std::ostringstream hp("");
-        std::ostringstream mp("");
+    render([this, rows]() {
+      for (const auto &r : rows) {
+        damage(r.line);
 
-        hp << p["HP/Current"];
-        mp << p["MP/Current"];
+        out.to(0, r.line).clear(-1, 1);
+        if (r.name.empty()) {
+          continue;
+        }
 
-        out.to(0, i)
-            .clear(-1, 1)
-            .to(2, i)
-            .write(p.name.full(), 28)
+        out.to(2, r.line)
+            .write(r.name, 28)
             .x(-60)
-            .write(hp.str(), 4, 1)
+            .write(std::to_string(r.hp), 4, 1)
             .x(-55)
-            .write(mp.str(), 4, 4)
+            .write(std::to_string(r.mp), 4, 4)
             .x(-50)
-            .bar2c(p["HP/Current"], p["HP/Total"], p["MP/Current"],
-                   p["MP/Total"], 50, 1, 4);
-        i++;
+            .bar2c(r.hp, r.hpTotal, r.mp, r.mpTotal, 50, 1, 4);
       }
+    });
+  }
+
+  /**\brief Pre-rendered box
+   *
+   * The cells of a box that was drawn before, row by row.
+   */
+  using sprite = std::vector<std::vector<typename term::cell>>;
+
+  /**\brief Pre-rendered boxes, by content and geometry
+   *
+   * Refresher thread only. Emptied whenever it reaches 'maxSprites' entries.
+   */
+  std::map<std::string, sprite> sprites;
+  std::size_t maxSprites = 64;
+
+  /**\brief Resource labels of query boxes, by menu
+   *
+   * A menu is identified by its title, its entries and the revisions of the
+   * source's attributes and of the game's actions, so labels are only looked
+   * up again when a cost or resource may have changed. Game thread only.
+   * Emptied whenever it reaches 'maxSprites' entries.
+   */
+  std::map<std::string, std::vector<std::string>> menuLabels;
+
+  static std::string spriteKey(std::initializer_list<std::string> parts,
+                               std::size_t left, std::size_t top,
+                               std::size_t width, std::size_t height) {
+    std::string key = std::to_string(left) + ',' + std::to_string(top) + ',' +
+                      std::to_string(width) + ',' + std::to_string(height);
+    for (const auto &p : parts) {
+      key += '\0' + p;
     }
+    return key + '\0';
   }
 
-  void clearQuery(void) { out.to(0, 8).clear(-1, 10); }
+  /**\brief Draw a box, or copy a previous rendering of it
+   *
+   * If a box with the same key was drawn before, its cells are copied to the
+   * screen as they were; otherwise the box is drawn and its cells are kept
+   * for next time. Only to be used from render commands.
+   *
+   * \param[in] key    Identifies the box; needs to cover everything that
+   *                   'draw' puts on the screen, including its position.
+   * \param[in] left   The first column of the box.
+   * \param[in] top    The first row of the box.
+   * \param[in] width  The number of columns of the box.
+   * \param[in] height The number of rows of the box.
+   * \param[in] draw   Draws the box through 'out', within the given area.
+   */
+  void blit(const std::string &key, std::size_t left, std::size_t top,
+            std::size_t width, std::size_t height,
+            const std::function<void(void)> &draw) {
+    auto &target = io.target;
+    const std::size_t bottom = std::min(top + height, target.size());
+
+    out.foreground = 7;
+    out.background = 0;
+    damage(top, height);
+
+    const auto it = sprites.find(key);
+    if (it != sprites.end()) {
+      for (std::size_t l = top; l < bottom; l++) {
+        const auto &row = it->second[l - top];
+        std::copy(row.begin(), row.end(),
+                  target[l].begin() + std::min(left, target[l].size()));
+      }
+      return;
+    }
+
+    draw();
+
+    if (sprites.size() >= maxSprites) {
+      sprites.clear();
+    }
+
+    auto &s = sprites[key];
+    for (std::size_t l = top; l < bottom; l++) {
+      const auto end = std::min(left + width, target[l].size());
+      s.emplace_back(target[l].begin() + std::min(left, end),
+                     target[l].begin() + end);
+    }
+  }
+
+  void clearQuery(void) {
+    invalidate(queryTop, queryRows);
+    render([this]() {
+      out.to(0, queryTop).clear(-1, queryRows);
+      damage(queryTop, queryRows);
+    });
+  }
 
   bool display(const std::string &title,
                const std::map<std::string, std::string> &data,
@@ -471,32 +1738,39 @@ public:
 
     lhs += 1;
 
-    std::size_t left = indent, top = 8,
+    sync();
+
+    std::size_t left = indent, top = queryTop,
                 width = 5 + std::max(title.size() + 4, lhs + rhs),
                 height = 3 + data.size();
 
-    out.foreground = 7;
-    out.background = 0;
+    std::string key = spriteKey({"display", title}, left, top, width, height);
+    for (const auto &it : data) {
+      key += it.first + '\0' + it.second + '\0';
+    }
 
-    out.to(left, top).box(width, height);
+    invalidate(top, height);
+    render([this, key, title, data, left, top, width, height, lhs, rhs]() {
+      blit(key, left, top, width, height, [&]() {
+        out.to(left, top).box(width, height);
+        out.to(left + 2, top).write(": " + title + " :", title.size() + 4);
+
+        std::size_t line = top;
+        for (const auto &it : data) {
+          line++;
+          out.to(left + 3, line).write(it.first, width - 4);
+          out.to(left + 3 + lhs, line).write(it.second, rhs);
+        }
 
-    out.to(left + 2, top).write(": " + title + " :", title.size() + 4);
+        out.to(left + 3, line + 1).write(std::string("OK"), width - 4);
+      });
+    });
 
     left += 3;
     width -= 4;
+    top += data.size() + 1;
 
-    for (const auto &it : data) {
-      top++;
-      out.to(left, top).write(it.first, width);
-      out.to(left + lhs, top).write(it.second, rhs);
-    }
-
-    top++;
-
-    out.to(left, top).write(std::string("OK"), width);
-
-    auto sel = new selector(left - 2, top, width + 2, 1);
-    addAnimator(sel);
+    auto &sel = animate<selector>(left - 2, top, width + 2, 1);
 
     bool didCancel = false;
     bool didSelect = false;
@@ -524,7 +1798,7 @@ public:
       didSelect |= didCancel;
     } while (!didSelect);
 
-    sel->expire();
+    expire(sel);
 
     return !didCancel;
   }
@@ -536,7 +1810,6 @@ public:
     std::size_t party = game.partyOf(source);
 
     if (game.useAI(source)) {
-      out.to(0, 15);
       return ai.query(game, source, pList, indent, carry);
     }
 
@@ -557,46 +1830,76 @@ public:
       }
     }
 
-    size_t left = indent, top = 8, width = source.name.display().size() + 9,
-           height = 2 + list.size(), llen = 0;
+    const std::string title = source.name.display();
 
+    std::string menu = title + '\0' + carry + '\0' +
+                       std::to_string(source.revision) + '\0' +
+                       std::to_string(game.actionRevision) + '\0';
     for (const auto &la : list) {
-      width = la.size() + 5 > width ? la.size() + 5 : width;
-      std::string label = game.getResourceLabel(carry + la, source);
-      llen = label.size() > llen ? label.size() : llen;
+      menu += la + '\0';
     }
 
-    width += llen;
-
-    out.foreground = 7;
-    out.background = 0;
+    auto it = menuLabels.find(menu);
+    if (it == menuLabels.end()) {
+      if (menuLabels.size() >= maxSprites) {
+        menuLabels.clear();
+      }
 
-    out.to(left, top).box(width, height);
+      std::vector<std::string> labels;
+      for (const auto &la : list) {
+        labels.push_back(game.getResourceLabel(carry + la, source));
+      }
+      it = menuLabels.emplace(menu, std::move(labels)).first;
+    }
+    const auto &labels = it->second;
 
-    out.to(left + 2, top).write(": " + source.name.display() + " :",
-                                source.name.display().size() + 4);
+    size_t left = indent, top = queryTop, width = title.size() + 9,
+           height = 2 + list.size(), llen = 0;
 
     for (std::size_t i = 0; i < list.size(); i++) {
-      out.to(left + 1, top + 1 + i).write("  " + list[i], width - 2);
+      width = list[i].size() + 5 > width ? list[i].size() + 5 : width;
+      llen = labels[i].size() > llen ? labels[i].size() : llen;
+    }
 
-      std::string label = game.getResourceLabel(carry + list[i], source);
-      if (label.size() > 0) {
-        out.to(left + width - llen - 2, top + 1 + i).write(label, llen);
-      }
+    width += llen;
+
+    sync();
+
+    if (reveal(game, source)) {
+      drawUI(game);
     }
 
+    const std::string key =
+        spriteKey({"query", menu}, left, top, width, height);
+
+    invalidate(top, height);
+    render([this, key, title, list, labels, left, top, width, height,
+            llen]() {
+      blit(key, left, top, width, height, [&]() {
+        out.to(left, top).box(width, height);
+        out.to(left + 2, top).write(": " + title + " :", title.size() + 4);
+
+        for (std::size_t i = 0; i < list.size(); i++) {
+          out.to(left + 1, top + 1 + i).write("  " + list[i], width - 2);
+
+          if (labels[i].size() > 0) {
+            out.to(left + width - llen - 2, top + 1 + i)
+                .write(labels[i], llen);
+          }
+        }
+      });
+    });
+
     long selection = 0;
     bool didSelect = false;
     bool didCancel = false;
 
-    auto sel = new selector(left + 1, top + 1, width - 2, 1);
-    auto actorHighlight =
-        new highlight(0, getLine(game, source), io.size()[0], 1);
-    addAnimator(sel);
-    addAnimator(actorHighlight);
+    auto &sel = animate<selector>(left + 1, top + 1, width - 2, 1);
+    auto &actorHighlight =
+        animate<highlight>(0, getLine(game, source), screen[0], 1);
 
     do {
-      sel->line = top + 1 + selection;
+      move(sel, top + 1 + selection);
 
       io.read([&selection, &didSelect, &didCancel](
                   const typename term::command &c) -> bool {
@@ -634,10 +1937,8 @@ public:
       }
     } while (!didSelect);
 
-    actorHighlight->expire();
-    sel->expire();
-
-    out.to(0, 15);
+    expire(actorHighlight);
+    expire(sel);
 
     if (didCancel) {
       return "Cancel";
@@ -663,12 +1964,11 @@ public:
   std::optional<std::vector<metaquest::character<T> *>>
   query(G &game, const metaquest::character<T> &source,
         std::vector<metaquest::character<T> *> &candidates,
-        std::size_t indent = 4) {
+        std::size_t indent = 4, const std::string &action = "") {
     std::size_t party = game.partyOf(source);
 
     if (game.useAI(source)) {
-      out.to(0, 15);
-      return ai.query(game, source, candidates, indent);
+      return ai.query(game, source, candidates, indent, action);
     }
 
     std::string hc;
@@ -676,25 +1976,49 @@ public:
       return candidates;
     }
 
-    std::sort(
-        candidates.begin(), candidates.end(),
-        [&game, this](metaquest::character<T> *a, metaquest::character<T> *b)
-            -> bool { return getLine(game, *a) < getLine(game, *b); });
+    sync();
+
+    const auto lists = combatants(game);
+    std::unordered_map<const metaquest::character<T> *, std::size_t> order;
+    std::vector<std::pair<std::size_t, metaquest::character<T> *>> rows;
+
+    for (const auto &c : lists[1]) {
+      order[c] = order.size();
+    }
+    for (const auto &c : lists[0]) {
+      order[c] = order.size();
+    }
+
+    for (auto &c : candidates) {
+      rows.push_back({order.at(c), c});
+    }
+
+    std::sort(rows.begin(), rows.end());
+
+    for (std::size_t i = 0; i < rows.size(); i++) {
+      candidates[i] = rows[i].second;
+    }
 
     std::vector<metaquest::character<T> *> targets;
-    long selection = 0;
+    long selection = 0, selected = -1;
     bool didSelect = false;
     bool didCancel = false;
 
-    auto sel = new selector(0, 0, io.size()[0], 1);
-    addAnimator(sel);
+    auto &sel = animate<selector>(0, 0, screen[0], 1);
 
-    do {
-      const auto &c = *(candidates[selection]);
-
-      drawUI(game);
+    reveal(game, *candidates[selection]);
+    drawUI(game);
+    auto lines = getLines(game);
 
-      sel->line = getLine(game, c);
+    do {
+      if (selection != selected) {
+        if (reveal(game, *candidates[selection])) {
+          drawUI(game);
+          lines = getLines(game);
+        }
+        move(sel, lines.at(candidates[selection]));
+        selected = selection;
+      }
 
       io.read([&selection, &didSelect, &didCancel](
                   const typename term::command &c) -> bool {
@@ -732,7 +2056,7 @@ public:
       }
     } while (!didSelect);
 
-    sel->expire();
+    expire(sel);
 
     if (didCancel) {
       return std::optional<std::vector<metaquest::character<T> *>>();
@@ -743,19 +2067,28 @@ public:
   }
 
   virtual bool load(efgy::json::json json) {
-    if (json("log").isArray()) {
-      logbook = json("log");
-    }
+    logbook.load(json("log"));
     return true;
   }
 
   virtual efgy::json::json json(void) const {
     efgy::json::json rv;
 
-    rv("log") = logbook;
+    rv("log") = logbook.json();
 
     return rv;
   }
+
+protected:
+  /**\brief End of the animation timeline
+   *
+   * The time at which the last queued combat animation finishes.
+   */
+  typename clock::time_point timeline;
+
+  typename clock::duration scale(const typename clock::duration &d) const {
+    return std::chrono::duration_cast<typename clock::duration>(d / speed);
+  }
 };
 }
 }
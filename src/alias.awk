@@ -0,0 +1,87 @@
+# Builds an alias table for sampling census names by frequency and prints it
+# as a C++ header.
+#
+# Input lines are the census 'dist' files: a name, followed by its frequency
+# in percent. Each name is weighted the same way as in the plain data headers.
+#
+# Variables:
+#   name - the identifier for the table, e.g. female_first
+#
+# Names are sorted by length, shortest first, keeping the census order for
+# names of the same length. Each entry has the name, its weight, the
+# probability of keeping it when it's drawn - scaled to 2^32 - and the entry
+# to take instead if it isn't kept (Vose's alias method).
+#
+# This file is part of the Metaquest project, which is released as open source
+# under the terms of an MIT/X11-style licence, described in the COPYING file.
+
+{
+  l = length($1)
+  if (l > longest) {
+    longest = l
+  }
+  bucket[l, count[l]++] = $1
+  weighted[l, count[l] - 1] = int($2 * 1000 + 1)
+}
+
+END {
+  n = 0
+  total = 0
+  for (l = 1; l <= longest; l++) {
+    for (i = 0; i < count[l]; i++) {
+      names[n] = bucket[l, i]
+      weight[n] = weighted[l, i]
+      total += weight[n]
+      n++
+    }
+  }
+
+  small = 0
+  large = 0
+  for (i = 0; i < n; i++) {
+    p[i] = weight[i] * n / total
+    if (p[i] < 1) {
+      smaller[small++] = i
+    } else {
+      larger[large++] = i
+    }
+  }
+
+  while ((small > 0) && (large > 0)) {
+    s = smaller[--small]
+    g = larger[--large]
+    keep[s] = p[s]
+    alias[s] = g
+    p[g] = p[g] + p[s] - 1
+    if (p[g] < 1) {
+      smaller[small++] = g
+    } else {
+      larger[large++] = g
+    }
+  }
+  while (large > 0) {
+    g = larger[--large]
+    keep[g] = 1
+    alias[g] = g
+  }
+  while (small > 0) {
+    s = smaller[--small]
+    keep[s] = 1
+    alias[s] = s
+  }
+
+  type = "std::tuple<const char*,long,unsigned long,unsigned long>"
+
+  print "#include <array>"
+  print "#include <tuple>"
+  print "namespace data {"
+  print "namespace alias {"
+  print "static const std::array<" type "," n "> " name " {{"
+  for (i = 0; i < n; i++) {
+    printf " %s(\"%s\",%d,%.0f,%d),\n", type, names[i], weight[i],
+           keep[i] * 4294967296, alias[i]
+  }
+  print "    }};"
+  print "};"
+  print "};"
+}
@@ -19,7 +19,9 @@
  */
 
 #include <fstream>
+#include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 #include <metaquest/terminal.h>
 #include <metaquest/party.h>
@@ -33,6 +35,33 @@ using namespace efgy;
 static cli::flag<std::string> saveFile("save-file",
                                        "where to store/load game data to/from");
 
+static cli::flag<std::string>
+    logFile("log-file", "where to append combat log entries that no longer "
+                        "fit in memory");
+
+static cli::flag<std::string>
+    combatLog("combat-log", "where to append per-action combat statistics");
+
+static cli::flag<std::string>
+    animationSpeed("animation-speed",
+                   "combat animation speed multiplier; 0 skips animations");
+
+static cli::flag<std::string>
+    renderStatistics("render-statistics",
+                     "where to write frame timing statistics to on exit");
+
+/**\brief Print usage
+ *
+ * \param[in] name The name the programme was run as.
+ *
+ * \returns The exit status for invalid arguments.
+ */
+static int usage(const char *name) {
+  std::cerr << "usage: " << name
+            << " [--animation-speed=<multiplier, or 0 to skip animations>]\n";
+  return 1;
+}
+
 /**\brief Metaquest: Arena main function
  *
  * This is the main function for the 'arena' programme. It is currently far from
@@ -44,13 +73,49 @@ int main(int argc, char **argv) {
   int rv = cli::options<>::common().apply(argc, argv);
 
   const std::string file = saveFile;
+  const std::string log = logFile;
+  const std::string combat = combatLog;
+  const std::string speed = animationSpeed;
+  const std::string statistics = renderStatistics;
+  std::ofstream statisticsFile;
   efgy::json::value<> json;
+  double multiplier = 0;
+
+  if (speed != "") {
+    try {
+      multiplier = std::stod(speed);
+    } catch (std::logic_error &) {
+      return usage(argv[0]);
+    }
+
+    if (!(multiplier >= 0)) {
+      return usage(argv[0]);
+    }
+  }
 
   {
     metaquest::flow::generic<metaquest::interact::terminal::base<>,
                              metaquest::rules::simple::game<
                                  metaquest::interact::terminal::base<>>> game;
 
+    if (speed != "") {
+      game.interact.speed = multiplier;
+    }
+
+    if (statistics != "") {
+      statisticsFile.open(statistics);
+      game.interact.statistics.dumpTo = &statisticsFile;
+      game.interact.statistics.enabled = true;
+    }
+
+    if (log != "") {
+      game.interact.logbook.open(log);
+    }
+
+    if (combat != "") {
+      game.interact.combat.open(combat);
+    }
+
     if (file != "") {
       std::ifstream save(file);
       std::istreambuf_iterator<char> eos;
@@ -0,0 +1,96 @@
+# Trains a Markov chain on census name data and prints the transition tables
+# as a C++ header.
+#
+# Input lines are the census 'dist' files: a name, followed by its frequency
+# in percent. Each name is weighted the same way as in the plain data headers.
+#
+# Variables:
+#   name  - the identifier prefix for the tables, e.g. female_first
+#   order - the number of characters the chain keeps in its context
+#
+# States are numbered in the order they're first seen, so state 0 is the empty
+# context that every name starts in. Transitions to the symbol 0 end a name.
+#
+# This file is part of the Metaquest project, which is released as open source
+# under the terms of an MIT/X11-style licence, described in the COPYING file.
+
+function context(s) {
+  return length(s) > order ? substr(s, length(s) - order + 1) : s
+}
+
+function state(c) {
+  if (!(c in index_)) {
+    index_[c] = states
+    key[states] = c
+    transitions[states] = 0
+    states++
+  }
+  return index_[c]
+}
+
+function add(c, symbol, weight,  s, i) {
+  s = state(c)
+  if (!((s, symbol) in slot)) {
+    i = transitions[s]++
+    slot[s, symbol] = i
+    target[s, i] = symbol
+    count[s, i] = 0
+  }
+  count[s, slot[s, symbol]] += weight
+}
+
+BEGIN {
+  for (i = 1; i < 256; i++) {
+    ord[sprintf("%c", i)] = i
+  }
+  states = 0
+  state("")
+}
+
+{
+  weight = int($2 * 1000 + 1)
+  for (i = 1; i <= length($1); i++) {
+    add(context(substr($1, 1, i - 1)), substr($1, i, 1), weight)
+  }
+  add(context($1), "", weight)
+}
+
+END {
+  edges = 0
+  for (s = 0; s < states; s++) {
+    edges += transitions[s]
+  }
+
+  print "#include <array>"
+  print "#include <tuple>"
+  print "namespace data {"
+  print "namespace markov {"
+
+  print "static const std::array<std::tuple<unsigned long,unsigned long,unsigned long>," states "> " name "_states {{"
+  first = 0
+  for (s = 0; s < states; s++) {
+    total = 0
+    for (i = 0; i < transitions[s]; i++) {
+      total += count[s, i]
+    }
+    print " std::tuple<unsigned long,unsigned long,unsigned long>(" first "," first + transitions[s] "," total "),"
+    first += transitions[s]
+  }
+  print "    }};"
+
+  print "static const std::array<std::tuple<char,unsigned long,unsigned long>," edges "> " name "_transitions {{"
+  for (s = 0; s < states; s++) {
+    for (i = 0; i < transitions[s]; i++) {
+      symbol = target[s, i]
+      if (symbol == "") {
+        print " std::tuple<char,unsigned long,unsigned long>(0," count[s, i] ",0),"
+      } else {
+        print " std::tuple<char,unsigned long,unsigned long>(" ord[symbol] "," count[s, i] "," index_[context(key[s] symbol)] "),"
+      }
+    }
+  }
+  print "    }};"
+
+  print "};"
+  print "};"
+}
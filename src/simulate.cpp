@@ -0,0 +1,143 @@
+/**\file
+ * \brief Metaquest: Simulate
+ *
+ * This is the 'simulate' programme of the metaquest project. It runs battles
+ * between AI-controlled parties on as many threads as you like, and shows a
+ * live dashboard of how they're going.
+ *
+ * \copyright
+ * This file is part of the Metaquest project, which is released as open source
+ * under the terms of an MIT/X11-style licence, described in the COPYING file.
+ *
+ * \see Documentation: https://ef.gy/documentation/metaquest
+ * \see Source Code: https://github.com/jyujin/metaquest
+ * \see Licence Terms: https://github.com/jyujin/metaquest/COPYING
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <metaquest/automatic.h>
+#include <metaquest/dashboard.h>
+#include <metaquest/rules-simple.h>
+#include <ef.gy/cli.h>
+
+using namespace efgy;
+
+static cli::flag<std::string> threads("threads",
+                                      "number of battles to run in parallel");
+
+static cli::flag<std::string>
+    duration("duration", "seconds to run for; 0 runs until interrupted");
+
+static cli::flag<std::string>
+    decisions("ai", "'random' for a plain random AI, 'cached' to put a "
+                    "decision cache in front of it");
+
+/**\brief Random AI behind a decision cache */
+template <typename inter>
+using cachedRandom = metaquest::ai::cache<inter, metaquest::ai::random>;
+
+/**\brief Print usage
+ *
+ * \param[in] name The name the programme was run as.
+ *
+ * \returns The exit status for invalid arguments.
+ */
+static int usage(const char *name) {
+  std::cerr << "usage: " << name
+            << " [--threads=<workers, at least 1>]"
+               " [--duration=<seconds, at least 0>] [--ai=random|cached]\n";
+  return 1;
+}
+
+/**\brief Metaquest: Simulate main function
+ *
+ * Starts the workers, updates the dashboard four times a second until the
+ * time is up, and then prints the totals.
+ *
+ * \returns 0 on success, something else otherwise.
+ */
+int main(int argc, char **argv) {
+  int rv = cli::options<>::common().apply(argc, argv);
+
+  using interaction = metaquest::interact::automatic<>;
+  using game = metaquest::rules::simple::game<interaction>;
+  using cachedInteraction = metaquest::interact::automatic<cachedRandom>;
+  using cachedGame = metaquest::rules::simple::game<cachedInteraction>;
+  using cache = cachedRandom<cachedInteraction>;
+
+  const std::string t = threads;
+  const std::string d = duration;
+  const std::string a = decisions;
+  const bool cached = a == "cached";
+  long n = std::max<long>(1, std::thread::hardware_concurrency());
+  double seconds = 30;
+
+  try {
+    if (t != "") {
+      n = std::stol(t);
+    }
+    if (d != "") {
+      seconds = std::stod(d);
+    }
+  } catch (std::logic_error &) {
+    return usage(argv[0]);
+  }
+
+  if ((n <= 0) || !(seconds >= 0) ||
+      ((a != "") && (a != "random") && !cached)) {
+    return usage(argv[0]);
+  }
+
+  std::vector<metaquest::dashboard::probe> probes(n);
+  std::atomic<bool> running(true);
+  std::vector<std::thread> workers;
+
+  for (auto &p : probes) {
+    if (cached) {
+      workers.emplace_back(
+          metaquest::dashboard::simulate<cachedInteraction, cachedGame>,
+          std::ref(p), std::cref(running), 1000);
+    } else {
+      workers.emplace_back(metaquest::dashboard::simulate<interaction, game>,
+                           std::ref(p), std::cref(running), 1000);
+    }
+  }
+
+  metaquest::dashboard::view<>::totals totals;
+
+  {
+    metaquest::dashboard::view<> view(probes);
+    const auto start = std::chrono::steady_clock::now();
+
+    while ((seconds <= 0) ||
+           (std::chrono::steady_clock::now() - start <
+            std::chrono::duration<double>(seconds))) {
+      view.update();
+      std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+
+    running = false;
+    for (auto &w : workers) {
+      w.join();
+    }
+
+    totals = view.sum();
+  }
+
+  std::cout << "battles: " << totals.battles
+            << "\nvictories: " << totals.victories
+            << "\ndefeats: " << totals.defeats << "\ndraws: " << totals.draws
+            << "\nactions: " << totals.actions << "\n";
+
+  if (cached) {
+    std::cout << "cached actions: " << cache::actions().hits.load() << " hits, "
+              << cache::actions().misses.load() << " misses\ncached targets: "
+              << cache::targets().hits.load() << " hits, "
+              << cache::targets().misses.load() << " misses\n";
+  }
+
+  return 0;
+}